@@ -0,0 +1,382 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <cmath>
+#include <new>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "ns3/core-module.h"
+#include "ns3/parameter.h"
+#include "ns3/content-cache.h"
+#include "ns3/content-fib.h"
+#include "ns3/content-index.h"
+#include "ns3/global-content-manager.h"
+
+using namespace ns3;
+
+/*
+ * Microbenchmarks of the CCDN data structures: the host and switch caches, the content
+ * fib of a switch and the content table of GlobalContentManager, driven by Zipf-popular
+ * content names with version bumps. Every run prints one CSV line:
+ *
+ *   bench,size,ops,seconds,ops_per_sec,ns_per_op,allocs_per_op,hit_ratio
+ *
+ * The operation stream is drawn before the clock starts, so only the structure is timed.
+ */
+
+//Every allocation of the process is counted, so allocs_per_op shows any heap use on the way.
+static uint64_t g_allocs = 0;
+
+void *operator new (size_t size) throw (std::bad_alloc)
+{
+    g_allocs ++;
+    void *p = malloc(size > 0 ? size : 1);
+    if (p == 0)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+void *operator new[] (size_t size) throw (std::bad_alloc)
+{
+    return operator new (size);
+}
+void operator delete (void *p) throw ()
+{
+    free(p);
+}
+void operator delete[] (void *p) throw ()
+{
+    free(p);
+}
+
+static double
+Now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//xorshift64*, only to draw the operation streams.
+struct BenchRandom
+{
+    uint64_t m_state;
+    BenchRandom(uint64_t seed) : m_state(seed | 1) {};
+    uint64_t Next()
+    {
+        m_state ^= m_state >> 12;
+        m_state ^= m_state << 25;
+        m_state ^= m_state >> 27;
+        return m_state * 0x2545f4914f6cdd1dULL;
+    };
+    double NextDouble() {return (Next() >> 11) * (1.0 / 9007199254740992.0);};
+};
+
+//Ranks 0..n-1 drawn with probability proportional to 1 / (rank + 1)^alpha.
+class ZipfStream
+{
+public:
+    ZipfStream(unsigned n, double alpha) : m_cdf(n)
+    {
+        double sum = 0;
+        for (unsigned i = 0; i < n; i++)
+        {
+            sum += 1.0 / std::pow(i + 1.0, alpha);
+            m_cdf[i] = sum;
+        }
+        for (unsigned i = 0; i < n; i++)
+        {
+            m_cdf[i] /= sum;
+        }
+    };
+    unsigned Draw(BenchRandom &random) const
+    {
+        return std::lower_bound(m_cdf.begin(), m_cdf.end() - 1, random.NextDouble()) - m_cdf.begin();
+    };
+private:
+    std::vector<double> m_cdf;
+};
+
+//A content name for a rank. Names are scattered the way real ones are.
+static inline uint64_t
+ContentName(unsigned rank)
+{
+    return ContentHashMix(rank + 1);
+}
+
+struct BenchOp
+{
+    unsigned rank;
+    unsigned arg;       //What the op does, and its interface or host.
+};
+
+static void
+DrawOps(std::vector<BenchOp> &ops, unsigned count, unsigned universe, double alpha, unsigned args, uint64_t seed)
+{
+    ZipfStream zipf(universe, alpha);
+    BenchRandom random(seed);
+    ops.resize(count);
+    for (unsigned i = 0; i < count; i++)
+    {
+        ops[i].rank = zipf.Draw(random);
+        ops[i].arg = random.Next() % args;
+    }
+}
+
+static void
+Report(const char *bench, unsigned size, unsigned ops, double seconds, uint64_t allocs, double hitratio)
+{
+    printf("%s,%u,%u,%.6f,%.0f,%.2f,%.4f,%.4f\n", bench, size, ops, seconds,
+           seconds > 0 ? ops / seconds : 0, seconds * 1e9 / ops, (double)allocs / ops, hitratio);
+    fflush(stdout);
+}
+
+/*
+ * A host cache: look the content up, and add it on a miss. One op in a hundred bumps the
+ * version of the content first, which outdates the cached copy.
+ */
+static void
+BenchCache(unsigned policy, unsigned size, unsigned count, double alpha, uint64_t seed)
+{
+    std::vector<BenchOp> ops;
+    DrawOps(ops, count, size * 10, alpha, 100, seed);
+    std::vector<uint32_t> versions(size * 10, 0);
+    ContentCache *cache = ContentCache::Create(policy, size);
+
+    uint64_t allocs = g_allocs;
+    double start = Now();
+    for (unsigned i = 0; i < count; i++)
+    {
+        const BenchOp &op = ops[i];
+        if (op.arg == 0)
+        {
+            versions[op.rank] ++;
+        }
+        uint64_t content = ContentName(op.rank);
+        if (!cache->HasCache(content, versions[op.rank]))
+        {
+            cache->AddCache(content, versions[op.rank]);
+        }
+    }
+    double seconds = Now() - start;
+    allocs = g_allocs - allocs;
+
+    std::string name = std::string("cache-") + CachePolicyName(policy);
+    Report(name.c_str(), size, count, seconds, allocs, cache->GetStats().GetHitRatio());
+    delete cache;
+}
+
+/*
+ * The fib of an aggregation switch of a k = ndnum fat-tree, as ContentLookup uses it: 70%
+ * requests (drop the incoming interface, look up, insert the upward interface on a miss),
+ * 29% replies (insert the incoming interface and refresh), 1% version bumps.
+ */
+static void
+BenchFib(unsigned size, unsigned count, double alpha, uint64_t seed)
+{
+    const unsigned ndnum = 16;
+    std::vector<BenchOp> ops;
+    DrawOps(ops, count, size * 10, alpha, 100 * ndnum, seed);
+    std::vector<uint32_t> versions(size * 10, 0);
+    Ptr<ContentFib> fib = Create<ContentFib>(ndnum, size);
+    uint64_t lookups = 0;
+    uint64_t hits = 0;
+
+    uint64_t allocs = g_allocs;
+    double start = Now();
+    for (unsigned i = 0; i < count; i++)
+    {
+        const BenchOp &op = ops[i];
+        unsigned kind = op.arg % 100;
+        int nd = op.arg / 100 + 1;
+        uint64_t content = ContentName(op.rank);
+        uint32_t version = versions[op.rank];
+        if (kind == 0)
+        {
+            versions[op.rank] ++;
+            fib->InsertFibND(content, version + 1, nd);
+        }
+        else if (kind < 71)
+        {
+            fib->RemoveFibND(content, version, nd);
+            lookups ++;
+            if (fib->GetForwardingND(content, version) != -1)
+            {
+                hits ++;
+            }
+            else
+            {
+                fib->InsertFibND(content, version, ndnum / 2 + 1 + nd % (ndnum / 2));
+            }
+        }
+        else
+        {
+            fib->InsertFibND(content, version, nd);
+            fib->FreshFibEntry(content, version);
+        }
+    }
+    double seconds = Now() - start;
+    allocs = g_allocs - allocs;
+
+    Report("fib", size, count, seconds, allocs, lookups > 0 ? (double)hits / lookups : 0);
+}
+
+//A k = 8 fat-tree, built once: ns-3 cannot build a second topology in the same process.
+static GlobalContentManager *
+CreateTableManager(Parameter &para)
+{
+    para.port = 8;
+    para.fib_size = 16;
+    para.cache_size = 1;
+    para.enable_cache = true;
+    para.cache_policy = CACHE_LRU;
+    para.switch_cache_size = 0;
+    para.switch_cache_layers = 0;
+    para.filename = (char *)"/dev/null";
+    para.result_format = RESULT_BINARY;
+    para.lean_topology = false;
+    para.fluid_transfer = false;
+    para.task_timeout = 0.5;
+    para.task_backoff = 2;
+    para.task_max_timeout = 8;
+    para.metrics_interval = 0;
+    para.metrics_format = METRICS_CSV;
+    para.systems = 1;
+    para.systemid = 0;
+
+    GlobalContentManager *manager = new GlobalContentManager();
+    manager->SetPara(&para);
+    manager->Create();
+    return manager;
+}
+
+/*
+ * The content table with 3 replicas per content: 90% location lookups from a random host,
+ * 9% updates, 1% contents created again on other hosts. The table is emptied afterwards.
+ */
+static void
+BenchContentTable(GlobalContentManager *manager, unsigned hosts, unsigned size, unsigned count, double alpha, uint64_t seed)
+{
+    BenchRandom random(seed + 1);
+    unsigned replicas[3];
+    for (unsigned i = 0; i < size; i++)
+    {
+        for (unsigned r = 0; r < 3; r++)
+        {
+            replicas[r] = random.Next() % hosts;
+        }
+        manager->CreateContent(ContentName(i), 3, replicas);
+    }
+
+    std::vector<BenchOp> ops;
+    DrawOps(ops, count, size, alpha, 100 * hosts, seed);
+    uint64_t found = 0;
+
+    uint64_t allocs = g_allocs;
+    double start = Now();
+    for (unsigned i = 0; i < count; i++)
+    {
+        const BenchOp &op = ops[i];
+        unsigned kind = op.arg % 100;
+        unsigned host = op.arg / 100;
+        uint64_t content = ContentName(op.rank);
+        if (kind < 90)
+        {
+            uint32_t version = 0;
+            if (manager->GetContentLocation(host, content, version) < hosts)
+            {
+                found ++;
+            }
+        }
+        else if (kind < 99)
+        {
+            manager->UpdateContent(content);
+        }
+        else
+        {
+            for (unsigned r = 0; r < 3; r++)
+            {
+                replicas[r] = (host + r * 7) % hosts;
+            }
+            manager->CreateContent(content, 3, replicas);
+        }
+    }
+    double seconds = Now() - start;
+    allocs = g_allocs - allocs;
+
+    Report("content-table", size, count, seconds, allocs, (double)found / count);
+    for (unsigned i = 0; i < size; i++)
+    {
+        manager->RemoveContent(ContentName(i));
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+    //Options:
+    //--ops=<operations per run>  --alpha=<Zipf exponent>  --seed=<seed of the operation streams>
+    //--bench=all|cache|fib|table
+    unsigned count = 1000000;
+    double alpha = 0.8;
+    uint32_t seed = 1;
+    std::string bench = "all";
+    CommandLine cmd;
+    cmd.AddValue("ops", "Operations per run", count);
+    cmd.AddValue("alpha", "Exponent of the Zipf popularity", alpha);
+    cmd.AddValue("seed", "Seed of the operation streams", seed);
+    cmd.AddValue("bench", "What to run: all, cache, fib or table", bench);
+    cmd.Parse(argc, argv);
+
+    static const unsigned sizes[] = {100, 1000, 10000, 100000};
+    static const unsigned numsizes = sizeof(sizes) / sizeof(sizes[0]);
+
+    printf("bench,size,ops,seconds,ops_per_sec,ns_per_op,allocs_per_op,hit_ratio\n");
+    if (bench == "all" || bench == "cache")
+    {
+        for (unsigned policy = CACHE_LRU; policy <= CACHE_TINYLFU; policy++)
+        {
+            for (unsigned s = 0; s < numsizes; s++)
+            {
+                BenchCache(policy, sizes[s], count, alpha, seed);
+            }
+        }
+    }
+    if (bench == "all" || bench == "fib")
+    {
+        for (unsigned s = 0; s < numsizes; s++)
+        {
+            BenchFib(sizes[s], count, alpha, seed);
+        }
+    }
+    if (bench == "all" || bench == "table")
+    {
+        Parameter para;
+        GlobalContentManager *manager = CreateTableManager(para);
+        for (unsigned s = 0; s < numsizes; s++)
+        {
+            BenchContentTable(manager, para.port * para.port * para.port / 4, sizes[s], count, alpha, seed);
+        }
+    }
+    Simulator::Destroy();
+    return 0;
+}
@@ -0,0 +1,102 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/log.h"
+#include "cmp-header.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CmpHeader");
+
+NS_OBJECT_ENSURE_REGISTERED (CmpHeader);
+
+TypeId
+CmpHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CmpHeader")
+    .SetParent<Header> ()
+    .AddConstructor<CmpHeader> ()
+  ;
+  return tid;
+}
+
+CmpHeader::CmpHeader ()
+  : m_content (0),
+    m_version (0),
+    m_type (0),
+    m_flags (0)
+{
+}
+
+CmpHeader::CmpHeader (uint64_t content, uint32_t version, uint8_t type, uint8_t flags)
+  : m_content (content),
+    m_version (version),
+    m_type (type),
+    m_flags (flags)
+{
+}
+
+TypeId
+CmpHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+CmpHeader::GetSerializedSize (void) const
+{
+  return m_size;
+}
+
+void
+CmpHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteHtonU64 (m_content);
+  start.WriteHtonU32 (m_version);
+  start.WriteU8 (m_type);
+  start.WriteU8 (m_flags);
+}
+
+uint32_t
+CmpHeader::Deserialize (Buffer::Iterator start)
+{
+  m_content = start.ReadNtohU64 ();
+  m_version = start.ReadNtohU32 ();
+  m_type = start.ReadU8 ();
+  m_flags = start.ReadU8 ();
+  return m_size;
+}
+
+void
+CmpHeader::Print (std::ostream &os) const
+{
+  os << "content=" << m_content << " version=" << m_version << " type=" << (unsigned)m_type << " flags=" << (unsigned)m_flags;
+}
+
+bool
+CmpHeader::PeekFromUdp (Ptr<const Packet> p, CmpHeader &header)
+{
+  uint8_t buffer[m_udpsize + m_size];
+  if (p->CopyData (buffer, sizeof (buffer)) < sizeof (buffer))
+    {
+      return false;
+    }
+
+  const uint8_t *b = buffer + m_udpsize;
+  uint64_t content = 0;
+  for (int i = 0; i < 8; i++)
+    {
+      content = (content << 8) | b[i];
+    }
+  uint32_t version = 0;
+  for (int i = 8; i < 12; i++)
+    {
+      version = (version << 8) | b[i];
+    }
+  header.m_content = content;
+  header.m_version = version;
+  header.m_type = b[12];
+  header.m_flags = b[13];
+  return true;
+}
+
+} // namespace ns3
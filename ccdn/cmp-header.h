@@ -0,0 +1,81 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef CMP_HEADER_H
+#define CMP_HEADER_H
+
+#include <inttypes.h>
+#include "ns3/header.h"
+#include "ns3/packet.h"
+
+namespace ns3 {
+
+/*
+ * Header of the content management protocol, carried right after the udp header.
+ * Wire format, 14 bytes in network byte order:
+ *
+ *   | content 8 | version 4 | type 1 | flags 1 |
+ *
+ * Types: 0 transfer finished (to the requester), 1 request, 2 reply, 3 finish (to the
+ * server), 4 reject.
+ */
+enum CmpFlag
+{
+  CMP_FLAG_CACHED = 0x01,       // Reply and transfer finished: the server has the content in its cache.
+  CMP_FLAG_SWITCH = 0x02        // Reply: a switch on the way answers from its on-path cache.
+};
+
+class CmpHeader : public Header
+{
+public:
+  static TypeId GetTypeId (void);
+  CmpHeader ();
+  CmpHeader (uint64_t content, uint32_t version, uint8_t type, uint8_t flags = 0);
+  virtual ~CmpHeader () {};
+
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  virtual void Print (std::ostream &os) const;
+
+  uint64_t GetContent (void) const { return m_content; };
+  uint32_t GetVersion (void) const { return m_version; };
+  uint8_t GetType (void) const { return m_type; };
+  uint8_t GetFlags (void) const { return m_flags; };
+  void SetContent (uint64_t content) { m_content = content; };
+  void SetVersion (uint32_t version) { m_version = version; };
+  void SetType (uint8_t type) { m_type = type; };
+  void SetFlags (uint8_t flags) { m_flags = flags; };
+
+  // Read the header behind the udp header of an ip payload, as switches see it. Nothing is
+  // allocated and the packet is left alone. Return false if the packet is too short.
+  static bool PeekFromUdp (Ptr<const Packet> p, CmpHeader &header);
+
+  static const uint32_t m_size = 14;
+  static const uint32_t m_udpsize = 8;
+  static const unsigned m_types = 5;
+
+private:
+  uint64_t m_content;
+  uint32_t m_version;
+  uint8_t m_type;
+  uint8_t m_flags;
+};
+
+// Cmp packets sent by the hosts and the caching switches, and received by the hosts, indexed by type.
+struct CmpStats
+{
+  uint64_t sent[CmpHeader::m_types];
+  uint64_t received[CmpHeader::m_types];
+
+  CmpStats ()
+  {
+    for (unsigned i = 0; i < CmpHeader::m_types; i++)
+      {
+        sent[i] = received[i] = 0;
+      }
+  };
+};
+
+} // namespace ns3
+
+#endif /* CMP_HEADER_H */
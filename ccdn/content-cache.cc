@@ -1,76 +1,630 @@
 #include <inttypes.h>
-#include <list>
+#include <string.h>
 
 #include "content-cache.h"
 
 namespace ns3
 {
 
+static const char *cachePolicyNames[] = {"lru", "lfu", "arc", "slru", "tinylfu"};
+
+int
+CachePolicyFromName(const char *name)
+{
+    for (unsigned i = 0; i < sizeof(cachePolicyNames) / sizeof(cachePolicyNames[0]); i++)
+    {
+        if (strcmp(name, cachePolicyNames[i]) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const char*
+CachePolicyName(unsigned policy)
+{
+    if (policy >= sizeof(cachePolicyNames) / sizeof(cachePolicyNames[0]))
+    {
+        return "unknown";
+    }
+    return cachePolicyNames[policy];
+}
+
+ContentCache*
+ContentCache::Create(unsigned policy, int cachesize)
+{
+    switch (policy)
+    {
+    case CACHE_LFU:
+        return new LfuContentCache(cachesize);
+    case CACHE_ARC:
+        return new ArcContentCache(cachesize);
+    case CACHE_SLRU:
+        return new SlruContentCache(cachesize);
+    case CACHE_TINYLFU:
+        return new TinyLfuContentCache(cachesize);
+    default:
+        return new LruContentCache(cachesize);
+    }
+}
+
 ContentCache::ContentCache(const int cachesize)
+    : m_index(cachesize > 0 ? cachesize : 0)
+{
+    m_cachesize = cachesize > 0 ? cachesize : 0;
+    m_slots = new Content[m_cachesize];
+    m_free = new int32_t[m_cachesize];
+    m_numfree = m_cachesize;
+    for (int i = 0; i < m_cachesize; i++)
+    {
+        m_free[i] = m_cachesize - 1 - i;
+    }
+}
+
+ContentCache::~ContentCache()
+{
+    delete [] m_slots;
+    delete [] m_free;
+}
+
+void
+ContentCache::FreeSlot(int32_t slot, bool evicted)
 {
-    m_cachesize = cachesize;
-    m_cache = new std::list<Content*>(0);
+    Remove(slot, evicted);
+    m_index.Erase(m_slots[slot].m_content);
+    m_free[m_numfree ++] = slot;
 }
 
 bool
 ContentCache::AddCache(uint64_t content, uint32_t version)
 {
-    if (HasCache(content, version))
+    Record(content);
+    int32_t slot = m_index.Find(content);
+    if (slot != -1)
+    {
+        if (m_slots[slot].m_version >= version)
+        {
+            Touch(slot);
+            return false;
+        }
+        FreeSlot(slot, false);
+    }
+
+    if (m_cachesize == 0)
     {
         return false;
     }
 
-    if ((int)m_cache->size() >= m_cachesize)
+    int32_t victim = Victim(content);
+    if (victim != -1)
     {
-        Content *c = m_cache->back();
-        m_cache->pop_back();
-        delete c;
+        FreeSlot(victim, true);
+        m_stats.evictions ++;
     }
 
-    Content *c = new Content;
-    c->m_content = content;
-    c->m_version = version;
-    m_cache->push_front(c);
+    slot = m_free[-- m_numfree];
+    m_slots[slot].m_content = content;
+    m_slots[slot].m_version = version;
+    m_index.Insert(content, slot);
+    Insert(slot);
+    m_stats.insertions ++;
     return true;
 }
 
 bool
 ContentCache::RemoveCache(uint64_t content)
 {
-    for (std::list<Content*>::iterator iter = m_cache->begin(); iter != m_cache->end(); iter ++)
+    int32_t slot = m_index.Find(content);
+    if (slot == -1)
     {
-        if ((*iter)->m_content == content)
-        {
-            Content *c = *iter;
-            m_cache->erase(iter);
-            delete c;
-            return true;
-        }
+        return false;
     }
-    return false;
+
+    FreeSlot(slot, false);
+    return true;
 }
 
 bool
 ContentCache::HasCache(uint64_t content, uint32_t version)
 {
-    for (std::list<Content*>::iterator iter = m_cache->begin(); iter != m_cache->end(); iter ++)
+    m_stats.lookups ++;
+    Record(content);
+    int32_t slot = m_index.Find(content);
+    if (slot == -1)
+    {
+        return false;
+    }
+
+    if (m_slots[slot].m_version >= version)
     {
-        if ((*iter)->m_content == content && (*iter)->m_version >= version)
+        Touch(slot);
+        m_stats.hits ++;
+        return true;
+    }
+
+    FreeSlot(slot, false);
+    return false;
+}
+
+
+
+LruContentCache::LruContentCache(const int cachesize)
+    : ContentCache(cachesize),
+      m_lru(GetCapacity())
+{
+}
+
+void
+LruContentCache::Touch(int32_t slot)
+{
+    m_lru.MoveToFront(slot);
+}
+
+int32_t
+LruContentCache::Victim(uint64_t content)
+{
+    return IsFull() ? m_lru.Back() : -1;
+}
+
+void
+LruContentCache::Insert(int32_t slot)
+{
+    m_lru.PushFront(slot);
+}
+
+void
+LruContentCache::Remove(int32_t slot, bool evicted)
+{
+    m_lru.Remove(slot);
+}
+
+
+
+LfuContentCache::LfuContentCache(const int cachesize)
+    : ContentCache(cachesize),
+      m_heap(GetCapacity())
+{
+    m_freq = new uint64_t[GetCapacity()];
+    m_age = 0;
+    m_clock = 0;
+}
+
+LfuContentCache::~LfuContentCache()
+{
+    delete [] m_freq;
+}
+
+void
+LfuContentCache::Touch(int32_t slot)
+{
+    m_freq[slot] ++;
+    m_heap.Update(slot, GetKey(slot));
+}
+
+int32_t
+LfuContentCache::Victim(uint64_t content)
+{
+    if (!IsFull())
+    {
+        return -1;
+    }
+    int32_t slot = m_heap.Top();
+    m_age = m_heap.GetKey(slot) >> 32;
+    return slot;
+}
+
+void
+LfuContentCache::Insert(int32_t slot)
+{
+    m_freq[slot] = 1;
+    m_heap.Push(slot, GetKey(slot));
+}
+
+void
+LfuContentCache::Remove(int32_t slot, bool evicted)
+{
+    m_heap.Remove(slot);
+}
+
+
+
+ArcContentCache::ArcContentCache(const int cachesize)
+    : ContentCache(cachesize),
+      m_t1(GetCapacity()),
+      m_t2(GetCapacity()),
+      m_ghostindex(GetCapacity()),
+      m_b1(GetCapacity()),
+      m_b2(GetCapacity())
+{
+    unsigned c = GetCapacity();
+    m_p = 0;
+    m_ghosts = new uint64_t[c];
+    m_ghostfree = new int32_t[c];
+    m_numghostfree = c;
+    for (unsigned i = 0; i < c; i++)
+    {
+        m_ghostfree[i] = c - 1 - i;
+    }
+    m_evictto = 0;
+    m_intot2 = false;
+}
+
+ArcContentCache::~ArcContentCache()
+{
+    delete [] m_ghosts;
+    delete [] m_ghostfree;
+}
+
+void
+ArcContentCache::Touch(int32_t slot)
+{
+    if (m_t1.Contains(slot))
+    {
+        m_t1.Remove(slot);
+        m_t2.PushFront(slot);
+    }
+    else
+    {
+        m_t2.MoveToFront(slot);
+    }
+}
+
+int32_t
+ArcContentCache::Replace(bool inb2)
+{
+    unsigned t1 = m_t1.GetSize();
+    if (t1 > 0 && (t1 > m_p || (inb2 && t1 == m_p) || m_t2.GetSize() == 0))
+    {
+        m_evictto = &m_b1;
+        return m_t1.Back();
+    }
+    m_evictto = &m_b2;
+    return m_t2.Back();
+}
+
+int32_t
+ArcContentCache::Victim(uint64_t content)
+{
+    unsigned c = GetCapacity();
+    unsigned b1 = m_b1.GetSize();
+    unsigned b2 = m_b2.GetSize();
+    m_evictto = 0;
+
+    int32_t ghost = m_ghostindex.Find(content);
+    if (ghost != -1)
+    {
+        //A ghost hit: the list it was evicted from should have been larger.
+        bool inb2 = m_b2.Contains(ghost);
+        if (!inb2)
         {
-            Content *c = *iter;
-            m_cache->erase(iter);
-            m_cache->push_front(c);
-            return true;
+            unsigned delta = b2 > b1 ? b2 / b1 : 1;
+            m_p = m_p + delta < c ? m_p + delta : c;
         }
-        else if ((*iter)->m_content == content && (*iter)->m_version < version)
+        else
         {
-            Content *c = *iter;
-            m_cache->erase(iter);
-            delete c;
-            return false;
+            unsigned delta = b1 > b2 ? b1 / b2 : 1;
+            m_p = m_p > delta ? m_p - delta : 0;
         }
+        DropGhost(ghost);
+        m_intot2 = true;
+        return IsFull() ? Replace(inb2) : -1;
+    }
+
+    m_intot2 = false;
+    unsigned t1 = m_t1.GetSize();
+    if (t1 + b1 >= c)
+    {
+        if (t1 < c)
+        {
+            DropGhost(m_b1.Back());
+        }
+        else
+        {
+            //T1 alone fills the cache: its LRU end goes without a ghost.
+            return m_t1.Back();
+        }
+    }
+    else if (t1 + m_t2.GetSize() + b1 + b2 >= 2 * c && b2 > 0)
+    {
+        DropGhost(m_b2.Back());
+    }
+    return IsFull() ? Replace(false) : -1;
+}
+
+void
+ArcContentCache::Insert(int32_t slot)
+{
+    if (m_intot2)
+    {
+        m_t2.PushFront(slot);
+    }
+    else
+    {
+        m_t1.PushFront(slot);
+    }
+    m_intot2 = false;
+    m_evictto = 0;
+}
+
+void
+ArcContentCache::Remove(int32_t slot, bool evicted)
+{
+    if (m_t1.Contains(slot))
+    {
+        m_t1.Remove(slot);
+    }
+    else
+    {
+        m_t2.Remove(slot);
+    }
+    if (evicted && m_evictto != 0)
+    {
+        AddGhost(GetContent(slot), *m_evictto);
+    }
+}
+
+void
+ArcContentCache::AddGhost(uint64_t content, ContentLruList &list)
+{
+    //Removed contents leave the cache without ghosts, so the directory may be off balance.
+    if (m_numghostfree == 0)
+    {
+        DropGhost(m_b1.GetSize() >= m_b2.GetSize() ? m_b1.Back() : m_b2.Back());
+    }
+    int32_t ghost = m_ghostfree[-- m_numghostfree];
+    m_ghosts[ghost] = content;
+    m_ghostindex.Insert(content, ghost);
+    list.PushFront(ghost);
+}
+
+void
+ArcContentCache::DropGhost(int32_t ghost)
+{
+    if (m_b1.Contains(ghost))
+    {
+        m_b1.Remove(ghost);
+    }
+    else
+    {
+        m_b2.Remove(ghost);
+    }
+    m_ghostindex.Erase(m_ghosts[ghost]);
+    m_ghostfree[m_numghostfree ++] = ghost;
+}
+
+
+
+SlruContentCache::SlruContentCache(const int cachesize)
+    : ContentCache(cachesize),
+      m_probation(GetCapacity()),
+      m_protected(GetCapacity())
+{
+    m_protectedmax = GetCapacity() * m_protectedshare;
+}
+
+void
+SlruContentCache::Touch(int32_t slot)
+{
+    if (m_protected.Contains(slot))
+    {
+        m_protected.MoveToFront(slot);
+        return;
+    }
+    if (m_protectedmax == 0)
+    {
+        m_probation.MoveToFront(slot);
+        return;
+    }
+    m_probation.Remove(slot);
+    m_protected.PushFront(slot);
+    if (m_protected.GetSize() > m_protectedmax)
+    {
+        int32_t demoted = m_protected.Back();
+        m_protected.Remove(demoted);
+        m_probation.PushFront(demoted);
+    }
+}
+
+int32_t
+SlruContentCache::Victim(uint64_t content)
+{
+    if (!IsFull())
+    {
+        return -1;
+    }
+    return m_probation.GetSize() > 0 ? m_probation.Back() : m_protected.Back();
+}
+
+void
+SlruContentCache::Insert(int32_t slot)
+{
+    m_probation.PushFront(slot);
+}
+
+void
+SlruContentCache::Remove(int32_t slot, bool evicted)
+{
+    if (m_protected.Contains(slot))
+    {
+        m_protected.Remove(slot);
+    }
+    else
+    {
+        m_probation.Remove(slot);
+    }
+}
+
+
+
+FrequencySketch::FrequencySketch(unsigned capacity)
+{
+    unsigned width = 16;
+    while (width < capacity)
+    {
+        width <<= 1;
+    }
+    m_mask = width - 1;
+    m_table = new uint8_t[m_rows * width];
+    memset(m_table, 0, m_rows * width);
+    m_additions = 0;
+    m_samplesize = m_samplefactor * width;
+}
+
+FrequencySketch::~FrequencySketch()
+{
+    delete [] m_table;
+}
+
+//The rows are indexed by double hashing of one mixed name.
+void
+FrequencySketch::Increment(uint64_t content)
+{
+    uint64_t hash = ContentHashMix(content);
+    uint32_t h1 = hash;
+    uint32_t h2 = (hash >> 32) | 1;
+    bool added = false;
+    for (int i = 0; i < m_rows; i++)
+    {
+        uint8_t &counter = m_table[i * (m_mask + 1) + ((h1 + i * h2) & m_mask)];
+        if (counter < m_maxcount)
+        {
+            counter ++;
+            added = true;
+        }
+    }
+    if (added && ++ m_additions >= m_samplesize)
+    {
+        Halve();
+    }
+}
+
+unsigned
+FrequencySketch::Estimate(uint64_t content) const
+{
+    uint64_t hash = ContentHashMix(content);
+    uint32_t h1 = hash;
+    uint32_t h2 = (hash >> 32) | 1;
+    unsigned count = m_maxcount;
+    for (int i = 0; i < m_rows; i++)
+    {
+        unsigned counter = m_table[i * (m_mask + 1) + ((h1 + i * h2) & m_mask)];
+        count = counter < count ? counter : count;
+    }
+    return count;
+}
+
+void
+FrequencySketch::Halve()
+{
+    for (unsigned i = 0; i < m_rows * (m_mask + 1); i++)
+    {
+        m_table[i] >>= 1;
+    }
+    m_additions /= 2;
+}
+
+
+
+TinyLfuContentCache::TinyLfuContentCache(const int cachesize)
+    : ContentCache(cachesize),
+      m_sketch(GetCapacity()),
+      m_window(GetCapacity()),
+      m_probation(GetCapacity()),
+      m_protected(GetCapacity())
+{
+    m_windowmax = GetCapacity() * m_windowshare;
+    m_windowmax = m_windowmax > 0 ? m_windowmax : 1;
+    m_protectedmax = GetCapacity() > (int)m_windowmax ? (GetCapacity() - m_windowmax) * m_protectedshare : 0;
+}
+
+void
+TinyLfuContentCache::Record(uint64_t content)
+{
+    m_sketch.Increment(content);
+}
+
+void
+TinyLfuContentCache::Touch(int32_t slot)
+{
+    if (m_window.Contains(slot))
+    {
+        m_window.MoveToFront(slot);
+    }
+    else if (m_protected.Contains(slot))
+    {
+        m_protected.MoveToFront(slot);
+    }
+    else if (m_protectedmax == 0)
+    {
+        m_probation.MoveToFront(slot);
+    }
+    else
+    {
+        m_probation.Remove(slot);
+        m_protected.PushFront(slot);
+        if (m_protected.GetSize() > m_protectedmax)
+        {
+            int32_t demoted = m_protected.Back();
+            m_protected.Remove(demoted);
+            m_probation.PushFront(demoted);
+        }
+    }
+}
+
+int32_t
+TinyLfuContentCache::MainVictim() const
+{
+    return m_probation.GetSize() > 0 ? m_probation.Back() : m_protected.Back();
+}
+
+int32_t
+TinyLfuContentCache::Victim(uint64_t content)
+{
+    if (m_window.GetSize() < m_windowmax)
+    {
+        return IsFull() ? MainVictim() : -1;
+    }
+
+    //The window is full, so its LRU end asks to enter the main cache.
+    int32_t candidate = m_window.Back();
+    if (!IsFull())
+    {
+        m_window.Remove(candidate);
+        m_probation.PushFront(candidate);
+        return -1;
+    }
+    int32_t victim = MainVictim();
+    if (victim == -1 || m_sketch.Estimate(GetContent(candidate)) <= m_sketch.Estimate(GetContent(victim)))
+    {
+        return candidate;
+    }
+    m_window.Remove(candidate);
+    m_probation.PushFront(candidate);
+    return victim;
+}
+
+void
+TinyLfuContentCache::Insert(int32_t slot)
+{
+    m_window.PushFront(slot);
+}
+
+void
+TinyLfuContentCache::Remove(int32_t slot, bool evicted)
+{
+    if (m_window.Contains(slot))
+    {
+        m_window.Remove(slot);
+    }
+    else if (m_protected.Contains(slot))
+    {
+        m_protected.Remove(slot);
+    }
+    else
+    {
+        m_probation.Remove(slot);
     }
-    return false;
 }
 
 };
@@ -2,7 +2,8 @@
 #define CONTENT_CACHE_H
 
 #include <inttypes.h>
-#include <list>
+
+#include "content-index.h"
 
 namespace ns3
 {
@@ -13,13 +14,50 @@ struct Content
     uint32_t    m_version;
 };
 
+enum CachePolicy
+{
+    CACHE_LRU = 0,          //Least recently used.
+    CACHE_LFU = 1,          //Least frequently used, with dynamic aging.
+    CACHE_ARC = 2,          //Adaptive replacement cache.
+    CACHE_SLRU = 3,         //Segmented LRU: a probation and a protected segment.
+    CACHE_TINYLFU = 4       //W-TinyLFU: a window LRU, then SLRU behind a frequency admission filter.
+};
+
+//Return the CachePolicy of a name (lru, lfu, arc, slru, tinylfu), or -1 if there is no such policy.
+int CachePolicyFromName(const char *name);
+const char *CachePolicyName(unsigned policy);
+
+struct CacheStats
+{
+    uint64_t    lookups;    //Calls of HasCache().
+    uint64_t    hits;
+    uint64_t    insertions;
+    uint64_t    evictions;  //Contents dropped to make room, not removed or outdated ones.
+
+    CacheStats() : lookups(0), hits(0), insertions(0), evictions(0) {};
+    void Add(const CacheStats &s)
+    {
+        lookups += s.lookups;
+        hits += s.hits;
+        insertions += s.insertions;
+        evictions += s.evictions;
+    };
+    double GetHitRatio() const {return lookups > 0 ? (double)hits / lookups : 0;};
+};
+
+/*
+ * A cache of content names. Entries live in one array of Content slots, and a hash index
+ * finds the slot of a name. Which slot to give up when the cache is full is left to the
+ * replacement policy, a subclass that keeps its own order over the slot numbers through
+ * the hooks below. No heap is touched after construction.
+ */
 class ContentCache
 {
 
 public:
 
-    ContentCache(const int cachesize);
-    ~ContentCache() {};
+    static ContentCache* Create(unsigned policy, int cachesize);
+    virtual ~ContentCache();
 
 
 
@@ -35,13 +73,242 @@ public:
     //If it is returned as true, then the hit cache will be set as recently visited.
     bool HasCache(uint64_t content, uint32_t version);
 
+    unsigned GetSize() const {return m_index.GetSize();};
+    const CacheStats &GetStats() const {return m_stats;};
 
 
+
+protected:
+
+    ContentCache(const int cachesize);
+
+    //The content is accessed, whether it is cached or not.
+    virtual void Record(uint64_t content) {};
+    //The cached slot is hit.
+    virtual void Touch(int32_t slot) = 0;
+    //The content is about to be inserted. Return the slot to evict for it, or -1 to evict
+    //nothing. A slot must be returned if the cache is full. Insert() follows right after.
+    virtual int32_t Victim(uint64_t content) = 0;
+    //The content has been put into the slot.
+    virtual void Insert(int32_t slot) = 0;
+    //The slot is about to be freed; evicted is false if it is removed or outdated instead.
+    virtual void Remove(int32_t slot, bool evicted) = 0;
+
+    int GetCapacity() const {return m_cachesize;};
+    bool IsFull() const {return m_numfree == 0;};
+    uint64_t GetContent(int32_t slot) const {return m_slots[slot].m_content;};
+
 private:
 
+    ContentCache(const ContentCache &);
+    ContentCache &operator = (const ContentCache &);
+
+    void FreeSlot(int32_t slot, bool evicted);
+
     int m_cachesize;
-    std::list<Content*>    *m_cache;
+    Content         *m_slots;
+    int32_t         *m_free;        //Stack of unused slots.
+    unsigned        m_numfree;
+    ContentIndex    m_index;
+    CacheStats      m_stats;
+
+
+};
+
+class LruContentCache : public ContentCache
+{
+
+public:
+
+    LruContentCache(const int cachesize);
+
+protected:
+
+    virtual void Touch(int32_t slot);
+    virtual int32_t Victim(uint64_t content);
+    virtual void Insert(int32_t slot);
+    virtual void Remove(int32_t slot, bool evicted);
+
+private:
+
+    ContentLruList  m_lru;
+
+};
+
+/*
+ * LFU with dynamic aging. A slot is keyed by the age of the cache plus the hits it had, and
+ * the age becomes the key of every evicted slot. So contents that were popular long ago
+ * cannot stay forever. Equal keys are evicted in LRU order.
+ */
+class LfuContentCache : public ContentCache
+{
+
+public:
+
+    LfuContentCache(const int cachesize);
+    ~LfuContentCache();
+
+protected:
+
+    virtual void Touch(int32_t slot);
+    virtual int32_t Victim(uint64_t content);
+    virtual void Insert(int32_t slot);
+    virtual void Remove(int32_t slot, bool evicted);
+
+private:
+
+    //The priority in the high half, the access order in the low half.
+    uint64_t GetKey(int32_t slot) {return ((m_age + m_freq[slot]) << 32) | (uint32_t)(m_clock ++);};
+
+    ContentHeap     m_heap;
+    uint64_t        *m_freq;
+    uint64_t        m_age;
+    uint64_t        m_clock;
+
+};
+
+/*
+ * ARC (Megiddo and Modha). T1 holds contents seen once recently and T2 contents seen at
+ * least twice. B1 and B2 remember the names lately evicted from them, and a hit on those
+ * ghosts moves the target size p of T1 toward the list that would have kept the content.
+ */
+class ArcContentCache : public ContentCache
+{
+
+public:
+
+    ArcContentCache(const int cachesize);
+    ~ArcContentCache();
+
+protected:
+
+    virtual void Touch(int32_t slot);
+    virtual int32_t Victim(uint64_t content);
+    virtual void Insert(int32_t slot);
+    virtual void Remove(int32_t slot, bool evicted);
+
+private:
+
+    //Pick the victim from T1 or T2, and the ghost list it goes to.
+    int32_t Replace(bool inb2);
+    void AddGhost(uint64_t content, ContentLruList &list);
+    void DropGhost(int32_t ghost);
+
+    ContentLruList  m_t1;
+    ContentLruList  m_t2;
+    unsigned        m_p;
+
+    //Ghosts live in their own slots.
+    uint64_t        *m_ghosts;
+    int32_t         *m_ghostfree;
+    unsigned        m_numghostfree;
+    ContentIndex    m_ghostindex;
+    ContentLruList  m_b1;
+    ContentLruList  m_b2;
+
+    //Left by Victim() for Remove() and Insert().
+    ContentLruList  *m_evictto;     //0 if the victim leaves no ghost.
+    bool            m_intot2;
+
+};
+
+/*
+ * Segmented LRU. New contents enter the probation segment, and a hit promotes them to the
+ * protected segment, which takes m_protectedshare of the cache and demotes its LRU end
+ * back to probation. Victims come from probation first.
+ */
+class SlruContentCache : public ContentCache
+{
+
+public:
+
+    SlruContentCache(const int cachesize);
+
+protected:
+
+    virtual void Touch(int32_t slot);
+    virtual int32_t Victim(uint64_t content);
+    virtual void Insert(int32_t slot);
+    virtual void Remove(int32_t slot, bool evicted);
+
+private:
+
+    ContentLruList  m_probation;
+    ContentLruList  m_protected;
+    unsigned        m_protectedmax;
+
+    static const double m_protectedshare = 0.8;
+
+};
+
+/*
+ * Approximate access counts of content names: a count-min sketch of 4-bit counters in four
+ * rows. All counters are halved after every m_samplefactor * width increments, so the
+ * counts follow recent popularity.
+ */
+class FrequencySketch
+{
+
+public:
+
+    FrequencySketch(unsigned capacity);
+    ~FrequencySketch();
+
+    void Increment(uint64_t content);
+    unsigned Estimate(uint64_t content) const;
+
+private:
+
+    FrequencySketch(const FrequencySketch &);
+    FrequencySketch &operator = (const FrequencySketch &);
+
+    void Halve();
+
+    uint8_t     *m_table;       //m_rows rows of m_mask + 1 counters.
+    unsigned    m_mask;
+    unsigned    m_additions;
+    unsigned    m_samplesize;
+
+    static const int m_rows = 4;
+    static const unsigned m_samplefactor = 10;
+    static const uint8_t m_maxcount = 15;
+
+};
+
+/*
+ * W-TinyLFU. New contents enter a small window LRU. The one pushed out of the window only
+ * enters the main SLRU if the sketch has seen it more often than the main victim it would
+ * replace; otherwise it is dropped. So a burst of one-time contents cannot flush the
+ * popular ones.
+ */
+class TinyLfuContentCache : public ContentCache
+{
+
+public:
+
+    TinyLfuContentCache(const int cachesize);
+
+protected:
+
+    virtual void Record(uint64_t content);
+    virtual void Touch(int32_t slot);
+    virtual int32_t Victim(uint64_t content);
+    virtual void Insert(int32_t slot);
+    virtual void Remove(int32_t slot, bool evicted);
+
+private:
+
+    int32_t MainVictim() const;
+
+    FrequencySketch m_sketch;
+    ContentLruList  m_window;
+    ContentLruList  m_probation;
+    ContentLruList  m_protected;
+    unsigned        m_windowmax;
+    unsigned        m_protectedmax;
 
+    static const double m_windowshare = 0.01;
+    static const double m_protectedshare = 0.8;
 
 };
 };
@@ -1,48 +1,54 @@
-#include <stdlib.h>
-#include "ns3/log.h"
+#include "ns3/assert.h"
 #include "content-fib-entry.h"
 
 
 namespace ns3
 {
 
-NS_LOG_COMPONENT_DEFINE ("ContentFibEntry");
-
-NS_OBJECT_ENSURE_REGISTERED (ContentFibEntry);
+ContentFibEntry::ContentFibEntry()
+{
+    Reset(0, 0, 0);
+}
 
 ContentFibEntry::ContentFibEntry(const int ndnum, uint64_t content, uint32_t version)
 {
+    Reset(ndnum, content, version);
+}
+
+void
+ContentFibEntry::Reset(const int ndnum, uint64_t content, uint32_t version)
+{
+    NS_ASSERT_MSG (ndnum <= m_maxnd, "ContentFibEntry supports at most " << m_maxnd << " interfaces");
     m_ndnum = ndnum;
     m_content = content;
     m_version = version;
-    m_ndarray = new bool[ndnum];
-    for (int i=0; i<m_ndnum; i++)
+    for (int i=0; i<m_maxnd/64; i++)
     {
-        m_ndarray[i] = false;
+        m_ndmask[i] = 0;
     }
 }
 
 bool
 ContentFibEntry::SetNDArray(int nd)
 {
-    if (nd >= m_ndnum)
+    if (nd < 0 || nd >= m_ndnum)
     {
         return false;
     }
 
-    m_ndarray[nd] = true;
+    m_ndmask[nd >> 6] |= (uint64_t)1 << (nd & 63);
     return true;
 }
 
 bool
 ContentFibEntry::ResetNDArray(int nd)
 {
-    if (nd >= m_ndnum)
+    if (nd < 0 || nd >= m_ndnum)
     {
         return false;
     }
 
-    m_ndarray[nd] = false;
+    m_ndmask[nd >> 6] &= ~((uint64_t)1 << (nd & 63));
     return true;
 }
 
@@ -50,15 +56,15 @@ int
 ContentFibEntry::GetSetNDNum()
 {
     int set_nd = 0;
-    for (int i=0; i<m_ndnum; i++)
+    for (int i=0; i<m_maxnd/64; i++)
     {
-        set_nd += m_ndarray[i];
+        set_nd += __builtin_popcountll(m_ndmask[i]);
     }
     return set_nd;
 }
 
 int
-ContentFibEntry::GetRandomSetND()
+ContentFibEntry::GetRandomSetND(NodeRandom &random)
 {
     int set_nd = GetSetNDNum();
     if (set_nd == 0)
@@ -66,20 +72,27 @@ ContentFibEntry::GetRandomSetND()
         return -1;
     }
 
-    set_nd = rand() % set_nd;
-    for (int i=0; i<m_ndnum; i++)
+    return GetNthSetND(random.Below(set_nd));
+}
+
+int
+ContentFibEntry::GetNthSetND(int n)
+{
+    for (int i=0; i<m_maxnd/64; i++)
     {
-        if (m_ndarray[i])
+        uint64_t word = m_ndmask[i];
+        int count = __builtin_popcountll(word);
+        if (n >= count)
+        {
+            n -= count;
+            continue;
+        }
+        //Drop the lowest set bits until the wanted one is the lowest.
+        for (; n > 0; n--)
         {
-            if (set_nd > 0)
-            {
-                set_nd --;
-            }
-            else
-            {
-                return i;
-            }
+            word &= word - 1;
         }
+        return i*64 + __builtin_ctzll(word);
     }
 
     return -1;
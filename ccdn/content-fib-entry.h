@@ -2,19 +2,27 @@
 #define CONTENT_FIB_ENTRY_H
 
 #include <inttypes.h>
-#include "ns3/type-id.h"
-#include "ns3/object-factory.h"
+#include "node-random.h"
 
 namespace ns3
 {
-class ContentFibEntry : public Object
+
+/*
+ * A content fib entry. The set of next hops is kept as a bitmask of the node's
+ * interfaces, so a switch may have up to m_maxnd interfaces (127 ports plus loopback).
+ * The entries are stored by value inside ContentFib, nothing is allocated per entry.
+ */
+class ContentFibEntry
 {
 
 public:
 
-    static TypeId GetTypeId (void) {return TypeId ("ns3::ContentFibEntry");};
+    ContentFibEntry();
     ContentFibEntry(const int ndnum, uint64_t content, uint32_t version);
-    ~ContentFibEntry() {delete m_ndarray;};
+    ~ContentFibEntry() {};
+
+    //Reinitialize the entry with no nd set.
+    void Reset(const int ndnum, uint64_t content, uint32_t version);
 
     //Get, set the content, version;
     uint64_t GetContent() {return m_content;};
@@ -28,8 +36,12 @@ public:
     bool ResetNDArray(int nd);
     //Get the number of set nd;
     int GetSetNDNum();
-    //Get a set nd. If there are multiple then return a random one.
-    int GetRandomSetND();
+    //Get a set nd. If there are multiple then pick one with the random stream of the switch.
+    int GetRandomSetND(NodeRandom &random);
+    //Get the n-th set nd, counted from 0 and from the lowest interface. Return -1 if there is no such nd.
+    int GetNthSetND(int n);
+
+    static const int m_maxnd = 128;
 
 
 private:
@@ -37,7 +49,7 @@ private:
 	int		    m_ndnum;
 	uint64_t	m_content;
 	uint32_t	m_version;
-	bool		*m_ndarray;
+	uint64_t	m_ndmask[m_maxnd/64];
 
 };
 };
@@ -1,5 +1,4 @@
 #include <inttypes.h>
-#include <list>
 #include "ns3/log.h"
 #include "content-fib.h"
 #include "content-fib-entry.h"
@@ -11,11 +10,34 @@ NS_LOG_COMPONENT_DEFINE ("ContentFib");
 
 NS_OBJECT_ENSURE_REGISTERED (ContentFib);
 
-ContentFib::ContentFib(int ndnum, int entrysize)
+ContentFib::ContentFib(int ndnum, int entrysize, uint32_t stream)
+    : m_index(entrysize > 0 ? entrysize : 0),
+      m_lru(entrysize > 0 ? entrysize : 0),
+      m_random(stream)
 {
     m_ndnum = ndnum;
-    m_entrysize = entrysize;
-    m_fib = new std::list<ContentFibEntry*>(0);
+    m_entrysize = entrysize > 0 ? entrysize : 0;
+    m_entries = new ContentFibEntry[m_entrysize];
+    m_free = new int32_t[m_entrysize];
+    m_numfree = m_entrysize;
+    for (int i = 0; i < m_entrysize; i++)
+    {
+        m_free[i] = m_entrysize - 1 - i;
+    }
+}
+
+ContentFib::~ContentFib()
+{
+    delete [] m_entries;
+    delete [] m_free;
+}
+
+void
+ContentFib::FreeSlot(int32_t slot)
+{
+    m_index.Erase(m_entries[slot].GetContent());
+    m_lru.Remove(slot);
+    m_free[m_numfree ++] = slot;
 }
 
 bool
@@ -25,9 +47,14 @@ ContentFib::InsertFibND(uint64_t content, uint32_t version, int nd)
     if (entry == 0)
     {
         InsertFibEntry(content, version);
+        entry = GetEntry(content, version);
+        if (entry == 0)
+        {
+            //The fib has no room at all.
+            return true;
+        }
     }
 
-    entry = GetEntry(content, version);
     if (entry->GetVersion() > version)
     {
         return false;
@@ -41,35 +68,40 @@ bool
 ContentFib::InsertFibEntry(uint64_t content, uint32_t version)
 {
     RemoveFibEntry(content);
-    if ((int)m_fib->size() >= m_entrysize)
+    if (m_entrysize == 0)
     {
-        ContentFibEntry *e = m_fib->back();
-        m_fib->pop_back();
-        delete e;
+        return false;
+    }
+    if (m_numfree == 0)
+    {
+        FreeSlot(m_lru.Back());
+        m_stats.evictions ++;
     }
-    ContentFibEntry *entry = new ContentFibEntry(m_ndnum, content, version);
-    m_fib->push_front(entry);
+    m_stats.insertions ++;
+
+    int32_t slot = m_free[-- m_numfree];
+    m_entries[slot].Reset(m_ndnum, content, version);
+    m_index.Insert(content, slot);
+    m_lru.PushFront(slot);
     return true;
 }
 
 bool
 ContentFib::FreshFibEntry(uint64_t content, uint32_t version)
 {
-    for (std::list<ContentFibEntry*>::iterator iter = m_fib->begin(); iter != m_fib->end(); iter ++)
+    int32_t slot = m_index.Find(content);
+    if (slot == -1)
     {
-        if ((*iter)->GetContent() == content && (*iter)->GetVersion() >= version)
-        {
-            ContentFibEntry *e = *iter;
-            m_fib->erase(iter);
-            m_fib->push_front(e);
-            return true;
-        }
-        else if ((*iter)->GetContent() == content && (*iter)->GetVersion() < version)
-        {
-            RemoveFibEntry(content);
-            return false;
-        }
+        return false;
     }
+
+    if (m_entries[slot].GetVersion() >= version)
+    {
+        m_lru.MoveToFront(slot);
+        return true;
+    }
+
+    FreeSlot(slot);
     return false;
 }
 
@@ -90,48 +122,50 @@ ContentFib::RemoveFibND(uint64_t content, uint32_t version, int nd)
 bool
 ContentFib::RemoveFibEntry(uint64_t content)
 {
-    for (std::list<ContentFibEntry*>::iterator iter = m_fib->begin(); iter != m_fib->end(); iter ++)
+    int32_t slot = m_index.Find(content);
+    if (slot == -1)
     {
-        if ((*iter)->GetContent() == content)
-        {
-            ContentFibEntry *e = *iter;
-            m_fib->erase(iter);
-            delete e;
-            return true;
-        }
+        return false;
     }
-    return false;
+
+    FreeSlot(slot);
+    return true;
 }
 
 ContentFibEntry*
 ContentFib::GetEntry(uint64_t content, uint32_t version)
 {
-    for (std::list<ContentFibEntry*>::iterator iter = m_fib->begin(); iter != m_fib->end(); iter ++)
+    int32_t slot = m_index.Find(content);
+    if (slot == -1)
     {
-        if ((*iter)->GetContent() == content && (*iter)->GetVersion() >= version)
-        {
-            return *iter;
-        }
-        else if ((*iter)->GetContent() == content && (*iter)->GetVersion() < version)
-        {
-            RemoveFibEntry(content);
-            return 0;
-        }
+        return 0;
     }
 
+    if (m_entries[slot].GetVersion() >= version)
+    {
+        return &m_entries[slot];
+    }
+
+    FreeSlot(slot);
     return 0;
 }
 
 int
 ContentFib::GetForwardingND(uint64_t content, uint32_t version)
 {
+    m_stats.lookups ++;
     ContentFibEntry *entry = GetEntry(content, version);
     if (entry == 0)
     {
         return -1;
     }
 
-    return entry->GetRandomSetND();
+    int nd = entry->GetRandomSetND(m_random);
+    if (nd != -1)
+    {
+        m_stats.hits ++;
+    }
+    return nd;
 }
 
 };
@@ -2,20 +2,45 @@
 #define CONTENT_FIB_H
 
 #include <inttypes.h>
-#include <list>
 #include "ns3/object-factory.h"
 #include "content-fib-entry.h"
+#include "content-index.h"
 
 namespace ns3
 {
+
+struct FibStats
+{
+    uint64_t    lookups;    //Calls of GetForwardingND().
+    uint64_t    hits;       //Lookups that found an interface.
+    uint64_t    insertions;
+    uint64_t    evictions;  //Entries dropped to make room, not removed or outdated ones.
+
+    FibStats() : lookups(0), hits(0), insertions(0), evictions(0) {};
+    void Add(const FibStats &s)
+    {
+        lookups += s.lookups;
+        hits += s.hits;
+        insertions += s.insertions;
+        evictions += s.evictions;
+    };
+    double GetHitRatio() const {return lookups > 0 ? (double)hits / lookups : 0;};
+};
+
+/*
+ * The content fib of a switch. All entries are preallocated in one array; a hash index
+ * finds the entry of a content and an LRU list through the entry slots picks the victim
+ * when the fib is full. Every operation is O(1).
+ */
 class ContentFib : public Object
 {
 
 public:
 
     static TypeId GetTypeId (void) {return TypeId ("ns3::ContentFib");};
-    ContentFib(const int ndnum, const int entrysize);
-    ~ContentFib() {};
+    //stream is the Node ID of the switch, which picks its random stream.
+    ContentFib(const int ndnum, const int entrysize, uint32_t stream = 0);
+    ~ContentFib();
 
 
     //Update an entry by inserting the specified content, version and nd.
@@ -38,12 +63,23 @@ public:
     //Get the forwarding interface;
     int GetForwardingND(uint64_t content, uint32_t version);
 
+    unsigned GetSize() const {return m_index.GetSize();};
+    const FibStats &GetStats() const {return m_stats;};
+
 private:
 
+    void FreeSlot(int32_t slot);
+
 	int m_ndnum;
 	int m_entrysize;
 
-	std::list<ContentFibEntry*> *m_fib;
+	ContentFibEntry	*m_entries;
+	int32_t			*m_free;		//Stack of unused slots.
+	unsigned		m_numfree;
+	ContentIndex	m_index;
+	ContentLruList	m_lru;
+	FibStats		m_stats;
+	NodeRandom		m_random;		//Picks one of several next hops.
 
 };
 };
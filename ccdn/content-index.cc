@@ -0,0 +1,348 @@
+#include <inttypes.h>
+
+#include "content-index.h"
+
+namespace ns3
+{
+
+ContentIndex::ContentIndex(unsigned capacity)
+{
+    //Keep the load factor under one half.
+    unsigned buckets = 16;
+    while (buckets < capacity * 2)
+    {
+        buckets <<= 1;
+    }
+    m_keys = 0;
+    m_slots = 0;
+    Allocate(buckets);
+}
+
+ContentIndex::~ContentIndex()
+{
+    delete [] m_keys;
+    delete [] m_slots;
+}
+
+void
+ContentIndex::Allocate(unsigned buckets)
+{
+    m_keys = new uint64_t[buckets];
+    m_slots = new int32_t[buckets];
+    m_mask = buckets - 1;
+    m_size = 0;
+    for (unsigned i = 0; i < buckets; i++)
+    {
+        m_slots[i] = -1;
+    }
+}
+
+void
+ContentIndex::Grow()
+{
+    uint64_t *keys = m_keys;
+    int32_t *slots = m_slots;
+    unsigned buckets = m_mask + 1;
+
+    Allocate(buckets * 2);
+    for (unsigned i = 0; i < buckets; i++)
+    {
+        if (slots[i] != -1)
+        {
+            Insert(keys[i], slots[i]);
+        }
+    }
+
+    delete [] keys;
+    delete [] slots;
+}
+
+int32_t
+ContentIndex::Find(uint64_t content) const
+{
+    unsigned b = ContentHashMix(content) & m_mask;
+    while (m_slots[b] != -1)
+    {
+        if (m_keys[b] == content)
+        {
+            return m_slots[b];
+        }
+        b = (b + 1) & m_mask;
+    }
+    return -1;
+}
+
+void
+ContentIndex::Insert(uint64_t content, int32_t slot)
+{
+    if ((m_size + 1) * 2 > m_mask + 1)
+    {
+        Grow();
+    }
+
+    unsigned b = ContentHashMix(content) & m_mask;
+    while (m_slots[b] != -1)
+    {
+        if (m_keys[b] == content)
+        {
+            m_slots[b] = slot;
+            return;
+        }
+        b = (b + 1) & m_mask;
+    }
+    m_keys[b] = content;
+    m_slots[b] = slot;
+    m_size ++;
+}
+
+bool
+ContentIndex::Erase(uint64_t content)
+{
+    unsigned b = ContentHashMix(content) & m_mask;
+    while (m_slots[b] != -1 && m_keys[b] != content)
+    {
+        b = (b + 1) & m_mask;
+    }
+    if (m_slots[b] == -1)
+    {
+        return false;
+    }
+
+    //Shift back every following key that would otherwise be cut off from its home bucket.
+    unsigned hole = b;
+    unsigned next = (b + 1) & m_mask;
+    while (m_slots[next] != -1)
+    {
+        unsigned home = ContentHashMix(m_keys[next]) & m_mask;
+        if (((next - home) & m_mask) >= ((next - hole) & m_mask))
+        {
+            m_keys[hole] = m_keys[next];
+            m_slots[hole] = m_slots[next];
+            hole = next;
+        }
+        next = (next + 1) & m_mask;
+    }
+    m_slots[hole] = -1;
+    m_size --;
+    return true;
+}
+
+void
+ContentIndex::Clear()
+{
+    for (unsigned i = 0; i <= m_mask; i++)
+    {
+        m_slots[i] = -1;
+    }
+    m_size = 0;
+}
+
+
+
+ContentLruList::ContentLruList(unsigned capacity)
+{
+    m_capacity = capacity;
+    m_prev = new int32_t[capacity];
+    m_next = new int32_t[capacity];
+    Clear();
+}
+
+ContentLruList::~ContentLruList()
+{
+    delete [] m_prev;
+    delete [] m_next;
+}
+
+void
+ContentLruList::PushFront(int32_t slot)
+{
+    m_prev[slot] = -1;
+    m_next[slot] = m_head;
+    if (m_head != -1)
+    {
+        m_prev[m_head] = slot;
+    }
+    else
+    {
+        m_tail = slot;
+    }
+    m_head = slot;
+    m_size ++;
+}
+
+void
+ContentLruList::PushBack(int32_t slot)
+{
+    m_next[slot] = -1;
+    m_prev[slot] = m_tail;
+    if (m_tail != -1)
+    {
+        m_next[m_tail] = slot;
+    }
+    else
+    {
+        m_head = slot;
+    }
+    m_tail = slot;
+    m_size ++;
+}
+
+void
+ContentLruList::Remove(int32_t slot)
+{
+    if (m_prev[slot] != -1)
+    {
+        m_next[m_prev[slot]] = m_next[slot];
+    }
+    else
+    {
+        m_head = m_next[slot];
+    }
+    if (m_next[slot] != -1)
+    {
+        m_prev[m_next[slot]] = m_prev[slot];
+    }
+    else
+    {
+        m_tail = m_prev[slot];
+    }
+    m_prev[slot] = -2;
+    m_next[slot] = -2;
+    m_size --;
+}
+
+void
+ContentLruList::MoveToFront(int32_t slot)
+{
+    if (slot == m_head)
+    {
+        return;
+    }
+    Remove(slot);
+    PushFront(slot);
+}
+
+void
+ContentLruList::Clear()
+{
+    for (unsigned i = 0; i < m_capacity; i++)
+    {
+        m_prev[i] = -2;
+        m_next[i] = -2;
+    }
+    m_head = -1;
+    m_tail = -1;
+    m_size = 0;
+}
+
+
+
+ContentHeap::ContentHeap(unsigned capacity)
+{
+    m_heap = new int32_t[capacity];
+    m_pos = new int32_t[capacity];
+    m_key = new uint64_t[capacity];
+    m_size = 0;
+    for (unsigned i = 0; i < capacity; i++)
+    {
+        m_pos[i] = -1;
+    }
+}
+
+ContentHeap::~ContentHeap()
+{
+    delete [] m_heap;
+    delete [] m_pos;
+    delete [] m_key;
+}
+
+void
+ContentHeap::Place(unsigned pos, int32_t slot)
+{
+    m_heap[pos] = slot;
+    m_pos[slot] = pos;
+}
+
+void
+ContentHeap::SiftUp(unsigned pos)
+{
+    int32_t slot = m_heap[pos];
+    while (pos > 0)
+    {
+        unsigned parent = (pos - 1) / 2;
+        if (m_key[m_heap[parent]] <= m_key[slot])
+        {
+            break;
+        }
+        Place(pos, m_heap[parent]);
+        pos = parent;
+    }
+    Place(pos, slot);
+}
+
+void
+ContentHeap::SiftDown(unsigned pos)
+{
+    int32_t slot = m_heap[pos];
+    while (true)
+    {
+        unsigned child = pos * 2 + 1;
+        if (child >= m_size)
+        {
+            break;
+        }
+        if (child + 1 < m_size && m_key[m_heap[child + 1]] < m_key[m_heap[child]])
+        {
+            child ++;
+        }
+        if (m_key[slot] <= m_key[m_heap[child]])
+        {
+            break;
+        }
+        Place(pos, m_heap[child]);
+        pos = child;
+    }
+    Place(pos, slot);
+}
+
+void
+ContentHeap::Push(int32_t slot, uint64_t key)
+{
+    m_key[slot] = key;
+    Place(m_size ++, slot);
+    SiftUp(m_size - 1);
+}
+
+void
+ContentHeap::Update(int32_t slot, uint64_t key)
+{
+    uint64_t old = m_key[slot];
+    m_key[slot] = key;
+    if (key < old)
+    {
+        SiftUp(m_pos[slot]);
+    }
+    else
+    {
+        SiftDown(m_pos[slot]);
+    }
+}
+
+void
+ContentHeap::Remove(int32_t slot)
+{
+    unsigned pos = m_pos[slot];
+    m_pos[slot] = -1;
+    m_size --;
+    if (pos == m_size)
+    {
+        return;
+    }
+    //Fill the hole with the last one, which may have to go either way.
+    int32_t last = m_heap[m_size];
+    Place(pos, last);
+    SiftUp(pos);
+    SiftDown(m_pos[last]);
+}
+
+};
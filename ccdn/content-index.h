@@ -0,0 +1,141 @@
+#ifndef CONTENT_INDEX_H
+#define CONTENT_INDEX_H
+
+#include <inttypes.h>
+
+namespace ns3
+{
+
+//Mix the bits of a content name, so that close names don't land in close buckets.
+inline uint64_t ContentHashMix(uint64_t content)
+{
+    content ^= content >> 33;
+    content *= 0xff51afd7ed558ccdULL;
+    content ^= content >> 33;
+    content *= 0xc4ceb9fe1a85ec53ULL;
+    content ^= content >> 33;
+    return content;
+}
+
+/*
+ * Open-addressing hash index from a 64-bit content name to a slot number.
+ * The slots themselves live in the user's own arrays, this class only finds them.
+ * Linear probing is used, and erasing shifts the following keys back, so there are
+ * no tombstones and a probe never gets slower over time.
+ */
+class ContentIndex
+{
+
+public:
+
+    //The index grows by itself if more than capacity keys are inserted.
+    ContentIndex(unsigned capacity);
+    ~ContentIndex();
+
+    //Return the slot of the content, or -1 if there is no this content.
+    int32_t Find(uint64_t content) const;
+    //Set the slot of the content. An old slot of the same content is overwritten.
+    void Insert(uint64_t content, int32_t slot);
+    //Return false if there is no this content.
+    bool Erase(uint64_t content);
+    void Clear();
+    unsigned GetSize() const {return m_size;};
+
+
+private:
+
+    ContentIndex(const ContentIndex &);
+    ContentIndex &operator = (const ContentIndex &);
+
+    void Allocate(unsigned buckets);
+    void Grow();
+
+    uint64_t    *m_keys;
+    int32_t     *m_slots;       //-1 means the bucket is empty.
+    unsigned    m_mask;
+    unsigned    m_size;
+
+};
+
+/*
+ * Doubly linked list threaded through two arrays of slot numbers, so that a slot can be
+ * moved or removed in O(1) and no list node is ever allocated.
+ */
+class ContentLruList
+{
+
+public:
+
+    ContentLruList(unsigned capacity);
+    ~ContentLruList();
+
+    void PushFront(int32_t slot);
+    void PushBack(int32_t slot);
+    void Remove(int32_t slot);
+    void MoveToFront(int32_t slot);
+    //Return -1 if the list is empty.
+    int32_t Front() const {return m_head;};
+    int32_t Back() const {return m_tail;};
+    //Walk from front to back. Return -1 at the end.
+    int32_t Next(int32_t slot) const {return m_next[slot];};
+    int32_t Prev(int32_t slot) const {return m_prev[slot];};
+    bool Contains(int32_t slot) const {return m_prev[slot] != -2;};
+    unsigned GetSize() const {return m_size;};
+    void Clear();
+
+
+private:
+
+    ContentLruList(const ContentLruList &);
+    ContentLruList &operator = (const ContentLruList &);
+
+    unsigned    m_capacity;
+    int32_t     *m_prev;        //-2 means the slot is not in the list.
+    int32_t     *m_next;
+    int32_t     m_head;
+    int32_t     m_tail;
+    unsigned    m_size;
+
+};
+
+/*
+ * Binary min-heap of slot numbers ordered by a 64-bit key per slot. The position of every
+ * slot is kept, so a slot can be re-keyed or removed in O(log n) without a search.
+ */
+class ContentHeap
+{
+
+public:
+
+    ContentHeap(unsigned capacity);
+    ~ContentHeap();
+
+    void Push(int32_t slot, uint64_t key);
+    void Update(int32_t slot, uint64_t key);
+    void Remove(int32_t slot);
+    //Return -1 if the heap is empty.
+    int32_t Top() const {return m_size > 0 ? m_heap[0] : -1;};
+    uint64_t GetKey(int32_t slot) const {return m_key[slot];};
+    bool Contains(int32_t slot) const {return m_pos[slot] != -1;};
+    unsigned GetSize() const {return m_size;};
+
+
+private:
+
+    ContentHeap(const ContentHeap &);
+    ContentHeap &operator = (const ContentHeap &);
+
+    void Place(unsigned pos, int32_t slot);
+    void SiftUp(unsigned pos);
+    void SiftDown(unsigned pos);
+
+    int32_t     *m_heap;
+    int32_t     *m_pos;         //-1 means the slot is not in the heap.
+    uint64_t    *m_key;
+    unsigned    m_size;
+
+};
+};
+
+
+#endif
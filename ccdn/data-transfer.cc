@@ -1,70 +1,314 @@
 #include <inttypes.h>
+#include <algorithm>
 #include "ns3/log.h"
 #include "ns3/core-module.h"
 #include "ns3/applications-module.h"
 #include "ns3/network-module.h"
 #include "ns3/internet-module.h"
-#include "ns3/object-factory.h"
 
 #include "data-transfer.h"
+#include "event-profiler.h"
 
 namespace ns3
 {
 
 NS_LOG_COMPONENT_DEFINE ("DataTransfer");
 
-NS_OBJECT_ENSURE_REGISTERED (DataTransfer);
+void
+DataTransfer::Reset(uint64_t content, uint32_t version, uint32_t bytes)
+{
+    m_content = content;
+    m_version = version;
+    m_total = TRANSFER_FRAME_HEADER + bytes;
+    m_written = 0;
+
+    for (int i = 0; i < 8; i++)
+    {
+        m_header[i] = (content >> (56 - 8*i)) & 0xFF;
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        m_header[8 + i] = (version >> (24 - 8*i)) & 0xFF;
+        m_header[12 + i] = (bytes >> (24 - 8*i)) & 0xFF;
+    }
+}
+
+bool
+DataTransfer::Write(Ptr<Socket> socket)
+{
+    while (m_written < m_total && socket->GetTxAvailable () > 0)
+    {
+        uint32_t space = socket->GetTxAvailable ();
+        int sent;
+        if (m_written < TRANSFER_FRAME_HEADER)
+        {
+            uint32_t len = std::min (TRANSFER_FRAME_HEADER - m_written, space);
+            sent = socket->Send (m_header + m_written, len, 0);
+        }
+        else
+        {
+            //The content bytes themselves are never looked at, so the packet carries no buffer.
+            uint32_t len = std::min (m_total - m_written, space);
+            sent = socket->Send (Create<Packet> (len), 0);
+        }
+        if (sent < 0)
+        {
+            // we will be called again when new tx space becomes available.
+            return false;
+        }
+        m_written += sent;
+    }
+    return m_written >= m_total;
+}
 
-DataTransfer::DataTransfer(GlobalContentManager *manager, uint32_t totalBytes, unsigned local, Ptr<Socket> socket, Ipv4Address dst, uint16_t port)
+
+TransferConnection::TransferConnection(TransferPool *pool, unsigned local, unsigned remote, Ptr<Socket> socket)
 {
-    father = manager;
-    totalTxBytes = totalBytes;
-    currentTxBytes = 0;
+    m_pool = pool;
+    m_local = local;
+    m_remote = remote;
     m_socket = socket;
-    m_dst = dst;
+    m_socket->SetSendCallback (MakeCallback (&ns3::TransferConnection::Pump, this));
+}
+
+TransferConnection::~TransferConnection()
+{
+    m_idle.Cancel();
+    m_socket->SetSendCallback (MakeNullCallback<void, Ptr<Socket>, uint32_t> ());
+    for (std::deque<DataTransfer*>::iterator iter = m_queue.begin(); iter != m_queue.end(); iter ++)
+    {
+        m_pool->Release(*iter);
+    }
+}
+
+void
+TransferConnection::Enqueue(DataTransfer *transfer)
+{
+    m_idle.Cancel();
+    m_queue.push_back(transfer);
+    if (m_queue.size() == 1)
+    {
+        Pump(m_socket, m_socket->GetTxAvailable ());
+    }
+}
+
+//Write the queued frames back to back, as far as the send buffer allows.
+void
+TransferConnection::Pump(Ptr<Socket> socket, uint32_t txSpace)
+{
+    ProfileScope profile(PROFILE_TRANSFER_SEND);
+    if (m_queue.empty() && m_idle.IsRunning())
+    {
+        return;
+    }
+    while (!m_queue.empty())
+    {
+        DataTransfer *transfer = m_queue.front();
+        if (!transfer->Write(socket))
+        {
+            return;
+        }
+        NS_LOG_LOGIC("Node " << m_local << " has written " << transfer->GetContent() << " for host " << m_remote);
+        m_queue.pop_front();
+        m_pool->Release(transfer);
+    }
+    m_idle.Cancel();
+    m_idle = Simulator::Schedule (Seconds (TransferPool::m_idletimeout), &ns3::TransferConnection::CloseIdle, this);
+}
+
+void
+TransferConnection::CloseIdle()
+{
+    NS_LOG_LOGIC("Connection from node " << m_local << " to host " << m_remote << " is idle, close it");
+    m_socket->Close ();
+    m_pool->Close(this);
+}
+
+
+TransferPool::TransferPool(FatTreeHelper *helper, uint16_t port)
+{
+    m_helper = helper;
     m_port = port;
-    finished = false;
-    m_local = local;
+    m_opened = 0;
+}
+
+TransferPool::~TransferPool()
+{
+    for (std::map<uint64_t, TransferConnection*>::iterator iter = m_connections.begin(); iter != m_connections.end(); iter ++)
+    {
+        delete iter->second;
+    }
+    for (unsigned i = 0; i < m_free.size(); i++)
+    {
+        delete m_free[i];
+    }
+}
+
+DataTransfer*
+TransferPool::Allocate()
+{
+    if (m_free.empty())
+    {
+        return new DataTransfer;
+    }
+    DataTransfer *transfer = m_free.back();
+    m_free.pop_back();
+    return transfer;
 }
 
 void
-DataTransfer::Start()
+TransferPool::Release(DataTransfer *transfer)
 {
-    Simulator::ScheduleNow(&ns3::DataTransfer::StartFlow, this);
+    m_free.push_back(transfer);
 }
 
 void
-DataTransfer::StartFlow ()
+TransferPool::Transfer(unsigned local, unsigned remote, uint32_t bytes, uint64_t content, uint32_t version)
 {
-    m_socket->Connect (InetSocketAddress(m_dst, m_port));
-    m_socket->SetSendCallback (MakeCallback (&ns3::DataTransfer::WriteUntilBufferFull, this));
-    WriteUntilBufferFull (m_socket, m_socket->GetTxAvailable ());
+    TransferFrom(m_helper->HostNodes().Get(local), remote, bytes, content, version);
 }
 
 void
-DataTransfer::WriteUntilBufferFull (Ptr<Socket> local_socket, uint32_t txSpace)
+TransferPool::TransferFrom(Ptr<Node> node, unsigned remote, uint32_t bytes, uint64_t content, uint32_t version)
 {
-    while (currentTxBytes < totalTxBytes && local_socket->GetTxAvailable () > 0)
+    unsigned local = node->GetId();
+    uint64_t key = ((uint64_t)local << 32) | remote;
+    std::map<uint64_t, TransferConnection*>::iterator iter = m_connections.find(key);
+    if (iter == m_connections.end())
     {
-        uint32_t left = totalTxBytes - currentTxBytes;
-        uint32_t dataOffset = currentTxBytes % writeSize;
-        uint32_t toWrite = writeSize - dataOffset;
-        toWrite = std::min (toWrite, left);
-        toWrite = std::min (toWrite, local_socket->GetTxAvailable ());
-        int amountSent = local_socket->Send (&data[dataOffset], toWrite, 0);
-        if(amountSent < 0)
+        Ptr<Socket> socket = Socket::CreateSocket (node, TypeId::LookupByName ("ns3::TcpSocketFactory"));
+        socket->Bind ();
+        socket->Connect (InetSocketAddress (Ipv4Address (m_helper->GetHostAddress(remote)), m_port));
+        iter = m_connections.insert(std::make_pair(key, new TransferConnection(this, local, remote, socket))).first;
+        m_opened ++;
+        NS_LOG_LOGIC("Open connection from node " << local << " to host " << remote << ", " << m_connections.size() << " open");
+    }
+
+    DataTransfer *transfer = Allocate();
+    transfer->Reset(content, version, bytes);
+    iter->second->Enqueue(transfer);
+}
+
+void
+TransferPool::Close(TransferConnection *connection)
+{
+    for (std::map<uint64_t, TransferConnection*>::iterator iter = m_connections.begin(); iter != m_connections.end(); iter ++)
+    {
+        if (iter->second == connection)
         {
-            // we will be called again when new tx space becomes available.
-            return;
+            m_connections.erase(iter);
+            break;
+        }
+    }
+    delete connection;
+}
+
+void
+TransferPool::Listen(unsigned host)
+{
+    Ptr<Socket> socket = Socket::CreateSocket (m_helper->HostNodes().Get(host), TypeId::LookupByName ("ns3::TcpSocketFactory"));
+    socket->Bind (InetSocketAddress (Ipv4Address (m_helper->GetHostAddress(host)), m_port));
+    socket->Listen ();
+    socket->SetAcceptCallback (MakeNullCallback<bool, Ptr<Socket>, const Address &> (),
+                               MakeCallback (&ns3::TransferPool::Accept, this));
+    m_listeners.push_back(socket);
+}
+
+void
+TransferPool::Accept(Ptr<Socket> socket, const Address &from)
+{
+    FrameReader &reader = m_readers[PeekPointer (socket)];
+    reader.m_local = m_helper->GetHostID(socket->GetNode());
+    reader.m_remote = m_helper->GetHostIDFromAddress(InetSocketAddress::ConvertFrom(from).GetIpv4().Get());
+    reader.m_headerused = 0;
+    reader.m_remaining = 0;
+    socket->SetRecvCallback (MakeCallback (&ns3::TransferPool::Receive, this));
+    socket->SetCloseCallbacks (MakeCallback (&ns3::TransferPool::Closed, this),
+                               MakeCallback (&ns3::TransferPool::Closed, this));
+}
+
+void
+TransferPool::Receive(Ptr<Socket> socket)
+{
+    ProfileScope profile(PROFILE_TRANSFER_RECEIVE);
+    std::map<Socket*, FrameReader>::iterator iter = m_readers.find(PeekPointer (socket));
+    NS_ASSERT_MSG (iter != m_readers.end(), "TransferPool: data on a connection that was never accepted");
+    FrameReader &reader = iter->second;
+
+    Ptr<Packet> packet;
+    while ((packet = socket->Recv ()))
+    {
+        uint32_t size = packet->GetSize();
+        uint32_t offset = 0;
+        while (offset < size)
+        {
+            if (reader.m_headerused < TRANSFER_FRAME_HEADER)
+            {
+                //Only the header bytes are copied out; they are rarely split over packets.
+                uint32_t len = std::min (TRANSFER_FRAME_HEADER - reader.m_headerused, size - offset);
+                if (offset == 0)
+                {
+                    packet->CopyData (reader.m_header + reader.m_headerused, len);
+                }
+                else
+                {
+                    packet->CreateFragment (offset, len)->CopyData (reader.m_header + reader.m_headerused, len);
+                }
+                reader.m_headerused += len;
+                offset += len;
+                if (reader.m_headerused == TRANSFER_FRAME_HEADER)
+                {
+                    reader.m_remaining = 0;
+                    for (int i = 12; i < 16; i++)
+                    {
+                        reader.m_remaining = (reader.m_remaining << 8) | reader.m_header[i];
+                    }
+                    if (reader.m_remaining == 0)
+                    {
+                        FrameEnd(reader);
+                    }
+                }
+            }
+            else
+            {
+                uint32_t len = std::min (reader.m_remaining, size - offset);
+                reader.m_remaining -= len;
+                offset += len;
+                if (reader.m_remaining == 0)
+                {
+                    FrameEnd(reader);
+                }
+            }
         }
-        currentTxBytes += amountSent;
     }
-    if (!finished && currentTxBytes >= totalTxBytes)
+}
+
+void
+TransferPool::FrameEnd(FrameReader &reader)
+{
+    uint64_t content = 0;
+    uint32_t version = 0;
+    for (int i = 0; i < 8; i++)
     {
-        finished = true;
-        father->InvokeTransferFinished(m_local, m_content, m_version, m_dst);
+        content = (content << 8) | reader.m_header[i];
     }
-    local_socket->Close ();
+    for (int i = 8; i < 12; i++)
+    {
+        version = (version << 8) | reader.m_header[i];
+    }
+    reader.m_headerused = 0;
+
+    NS_LOG_LOGIC("Host " << reader.m_local << " has received " << content << " from host " << reader.m_remote);
+    if (!ContentReceived.IsNull())
+    {
+        ContentReceived(reader.m_local, reader.m_remote, content, version);
+    }
+}
+
+void
+TransferPool::Closed(Ptr<Socket> socket)
+{
+    m_readers.erase(PeekPointer (socket));
 }
 
 };
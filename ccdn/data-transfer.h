@@ -2,45 +2,150 @@
 #define DATA_TRANSFER_H
 
 #include <inttypes.h>
+#include <deque>
+#include <map>
+#include <vector>
 #include "ns3/ptr.h"
 #include "ns3/socket.h"
 #include "ns3/inet-socket-address.h"
-#include "ns3/object-factory.h"
+#include "ns3/event-id.h"
+#include "ns3/callback.h"
 
-#include "global-content-manager.h"
+#include "fat-tree-helper.h"
 
 namespace ns3
 {
-class DataTransfer : public Object
+
+/*
+ * Contents are sent as frames over long-lived TCP connections, one connection for each
+ * (server, requester) pair. The server is a host, or a switch answering from its cache. A frame is a 16-byte header in network byte order followed by
+ * the content itself:
+ *
+ *   | content 8 | version 4 | length 4 | length bytes ...
+ *
+ * so the requester can tell where each content ends however the stream is segmented.
+ */
+static const uint32_t TRANSFER_FRAME_HEADER = 16;
+
+//One content on its way: the frame to write and how much of it is written.
+class DataTransfer
 {
 
 public:
 
-    static TypeId GetTypeId (void) {return TypeId ("ns3::DataTransfer");};
-    DataTransfer(GlobalContentManager *manager, uint32_t totalBytes, unsigned local, Ptr<Socket> socket, Ipv4Address dst, uint16_t port);
+    DataTransfer() {};
     ~DataTransfer() {};
 
-    void SetContent(uint64_t content, uint32_t version) {m_content = content; m_version = version;};
-    void Start();
-    void StartFlow ();
-    void WriteUntilBufferFull (Ptr<Socket> local_socket, uint32_t);
+    void Reset(uint64_t content, uint32_t version, uint32_t bytes);
+    //Write as much of the frame as the socket takes. Return true once all of it is written.
+    bool Write(Ptr<Socket> socket);
+
+    uint64_t GetContent() const {return m_content;};
+    uint32_t GetVersion() const {return m_version;};
 
 private:
 
     uint64_t m_content;
     uint32_t m_version;
-    unsigned m_local;
+    uint32_t m_total;       //Frame size, header included.
+    uint32_t m_written;
+    uint8_t m_header[TRANSFER_FRAME_HEADER];
+
+};
 
-    uint32_t totalTxBytes;
-    uint32_t currentTxBytes;
-    static const uint32_t writeSize = 1040;
-    uint8_t data[writeSize];
-    bool finished;
+class TransferPool;
+
+//The connection from a node to a host, and the transfers queued on it.
+class TransferConnection
+{
+
+public:
 
+    TransferConnection(TransferPool *pool, unsigned local, unsigned remote, Ptr<Socket> socket);
+    ~TransferConnection();
+
+    void Enqueue(DataTransfer *transfer);
+
+private:
+
+    TransferConnection(const TransferConnection &);
+    TransferConnection &operator = (const TransferConnection &);
+
+    void Pump(Ptr<Socket> socket, uint32_t txSpace);
+    void CloseIdle();
+
+    TransferPool *m_pool;
+    unsigned m_local;       //Node::GetId() of the sender.
+    unsigned m_remote;
     Ptr<Socket> m_socket;
-    Ipv4Address m_dst;
+    std::deque<DataTransfer*> m_queue;
+    EventId m_idle;
+
+};
+
+/*
+ * Sends contents between hosts over pooled connections, and reads the frames on the
+ * receiving hosts. A connection is opened by the first transfer between two hosts and
+ * closed after it has been idle for m_idletimeout, so only pairs that keep exchanging
+ * contents hold one. DataTransfer objects are recycled through a free list.
+ */
+class TransferPool
+{
+
+public:
+
+    TransferPool(FatTreeHelper *helper, uint16_t port);
+    ~TransferPool();
+
+    //The function to invoke with (requester, server, content, version) when a content has
+    //completely arrived at the requester. The server is -1 if it is a switch.
+    void SetReceiveCallback(Callback<void, unsigned, unsigned, uint64_t, uint32_t> receive) {ContentReceived = receive;};
+
+    //Accept connections on the host.
+    void Listen(unsigned host);
+    //Send a content of the given size from local to remote.
+    void Transfer(unsigned local, unsigned remote, uint32_t bytes, uint64_t content, uint32_t version);
+    //Send a content of the given size from any node, such as a switch, to the host remote.
+    void TransferFrom(Ptr<Node> node, unsigned remote, uint32_t bytes, uint64_t content, uint32_t version);
+
+    unsigned GetConnections() const {return m_connections.size();};
+    //Number of connections opened so far, i.e. handshakes.
+    uint64_t GetOpened() const {return m_opened;};
+
+    static const double m_idletimeout = 5.0;
+
+private:
+
+    friend class TransferConnection;
+
+    //The state of one accepted connection: where it is within the current frame.
+    struct FrameReader
+    {
+        unsigned m_local;
+        unsigned m_remote;  //-1 if the sender is a switch.
+        uint8_t m_header[TRANSFER_FRAME_HEADER];
+        uint32_t m_headerused;
+        uint32_t m_remaining;
+    };
+
+    DataTransfer *Allocate();
+    void Release(DataTransfer *transfer);
+    void Close(TransferConnection *connection);
+
+    void Accept(Ptr<Socket> socket, const Address &from);
+    void Receive(Ptr<Socket> socket);
+    void Closed(Ptr<Socket> socket);
+    void FrameEnd(FrameReader &reader);
+
+    FatTreeHelper *m_helper;
     uint16_t m_port;
-    GlobalContentManager *father;
+    std::map<uint64_t, TransferConnection*> m_connections;  //Keyed by Node::GetId() << 32 | remote.
+    std::vector<DataTransfer*> m_free;
+    std::map<Socket*, FrameReader> m_readers;
+    std::vector<Ptr<Socket> > m_listeners;
+    uint64_t m_opened;
+
+    Callback<void, unsigned, unsigned, uint64_t, uint32_t> ContentReceived;
 
 };
 };
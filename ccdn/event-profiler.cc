@@ -0,0 +1,93 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+#include <algorithm>
+#include "ns3/simulator.h"
+
+#include "event-profiler.h"
+
+namespace ns3
+{
+
+bool EventProfiler::m_enabled = false;
+uint64_t EventProfiler::m_cycles[PROFILE_KINDS];
+uint64_t EventProfiler::m_calls[PROFILE_KINDS];
+uint64_t EventProfiler::m_startcycles = 0;
+double EventProfiler::m_startseconds = 0;
+
+static const char *g_profileNames[PROFILE_KINDS] =
+{
+    "CreateContent", "RequireFile", "RecvCmpPacket", "ContentLookup", "IpHashLookup",
+    "TransferSend", "TransferReceive", "TaskRegister", "TaskUpdate", "TaskFinish",
+    "TaskReview", "TraceFill"
+};
+
+static double
+MonotonicSeconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//Sort the kinds by total cycles, the largest first.
+struct ProfileOrder
+{
+    const uint64_t *m_cycles;
+    ProfileOrder(const uint64_t *cycles) : m_cycles(cycles) {};
+    bool operator () (unsigned a, unsigned b) const {return m_cycles[a] > m_cycles[b];};
+};
+
+void
+EventProfiler::Enable()
+{
+    if (m_enabled)
+    {
+        return;
+    }
+    for (int i = 0; i < PROFILE_KINDS; i++)
+    {
+        m_cycles[i] = 0;
+        m_calls[i] = 0;
+    }
+    m_enabled = true;
+    m_startcycles = ReadCycles();
+    m_startseconds = MonotonicSeconds();
+    Simulator::ScheduleDestroy(&EventProfiler::Report);
+}
+
+void
+EventProfiler::Report()
+{
+    if (!m_enabled)
+    {
+        return;
+    }
+    m_enabled = false;
+    double seconds = MonotonicSeconds() - m_startseconds;
+    uint64_t cycles = ReadCycles() - m_startcycles;
+    double persecond = seconds > 0 && cycles > 0 ? cycles / seconds : 1e9;
+
+    unsigned order[PROFILE_KINDS];
+    for (unsigned i = 0; i < PROFILE_KINDS; i++)
+    {
+        order[i] = i;
+    }
+    std::sort(order, order + PROFILE_KINDS, ProfileOrder(m_cycles));
+
+    printf("profile over %.3f s wall clock (times include the calls made inside):\n", seconds);
+    printf("%-16s %12s %12s %10s %7s\n", "kind", "calls", "total ms", "ns/call", "share");
+    for (unsigned i = 0; i < PROFILE_KINDS; i++)
+    {
+        unsigned k = order[i];
+        if (m_calls[k] == 0)
+        {
+            continue;
+        }
+        double total = m_cycles[k] / persecond;
+        printf("%-16s %12llu %12.3f %10.1f %6.2f%%\n", g_profileNames[k], (unsigned long long)m_calls[k],
+               total * 1e3, total * 1e9 / m_calls[k], seconds > 0 ? total * 100 / seconds : 0);
+    }
+}
+
+};
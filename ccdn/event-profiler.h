@@ -0,0 +1,97 @@
+#ifndef EVENT_PROFILER_H
+#define EVENT_PROFILER_H
+
+#include <inttypes.h>
+#include <time.h>
+
+namespace ns3
+{
+
+//What is timed. Times are inclusive: ContentLookup contains the IpHashLookup it calls.
+enum ProfileKind
+{
+    PROFILE_CREATE_CONTENT = 0,     //GlobalContentManager::CreateContent
+    PROFILE_REQUIRE_FILE,           //GlobalContentManager::RequireFile
+    PROFILE_RECV_CMP,               //GlobalContentManager::RecvCmpPacket
+    PROFILE_CONTENT_LOOKUP,         //MixRouting::ContentLookup
+    PROFILE_IP_HASH_LOOKUP,         //MixRouting::IpHashLookup
+    PROFILE_TRANSFER_SEND,          //TransferConnection::Pump, filling the TCP send buffer
+    PROFILE_TRANSFER_RECEIVE,       //TransferPool::Receive
+    PROFILE_TASK_REGISTER,          //TaskRecorder::RegisterTask
+    PROFILE_TASK_UPDATE,            //TaskRecorder::UpdateTask
+    PROFILE_TASK_FINISH,            //TaskRecorder::FinishTask
+    PROFILE_TASK_REVIEW,            //TaskRecorder::ReviewTask
+    PROFILE_TRACE_FILL,             //TraceReplayer::Fill, scheduling the trace records
+    PROFILE_KINDS
+};
+
+/*
+ * Wall-clock time and calls of each ProfileKind, read from the time stamp counter where
+ * there is one. It is off unless Enable() is called; then each timed call costs a test of
+ * one flag. The report, sorted by total time, is printed when the simulator is destroyed.
+ */
+class EventProfiler
+{
+
+public:
+
+    static void Enable();
+    static bool IsEnabled() {return m_enabled;};
+
+    static uint64_t ReadCycles()
+    {
+#if defined(__i386__) || defined(__x86_64__)
+        uint32_t lo, hi;
+        __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+        return ((uint64_t)hi << 32) | lo;
+#else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+    };
+
+    static void Add(unsigned kind, uint64_t cycles)
+    {
+        m_cycles[kind] += cycles;
+        m_calls[kind] ++;
+    };
+
+    static void Report();
+
+private:
+
+    static bool         m_enabled;
+    static uint64_t     m_cycles[PROFILE_KINDS];
+    static uint64_t     m_calls[PROFILE_KINDS];
+    //Taken by Enable() and Report() to convert cycles into seconds.
+    static uint64_t     m_startcycles;
+    static double       m_startseconds;
+
+};
+
+//Times the rest of the enclosing block.
+class ProfileScope
+{
+
+public:
+
+    ProfileScope(unsigned kind) : m_kind(kind), m_start(EventProfiler::IsEnabled() ? EventProfiler::ReadCycles() : 0) {};
+    ~ProfileScope()
+    {
+        if (m_start != 0)
+        {
+            EventProfiler::Add(m_kind, EventProfiler::ReadCycles() - m_start);
+        }
+    };
+
+private:
+
+    unsigned    m_kind;
+    uint64_t    m_start;
+
+};
+};
+
+
+#endif
@@ -21,8 +21,12 @@
 
 #define __STDC_LIMIT_MACROS 1
 #include <sstream>
+#include <fstream>
+#include <string>
+#include <string.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <algorithm>
 
 #include "fat-tree-helper.h"
 
@@ -91,6 +95,7 @@ FatTreeHelper::GetTypeId (void)
 
 FatTreeHelper::FatTreeHelper()
 {
+  m_bytesPerNode = 0;
   m_channelFactory.SetTypeId ("ns3::PointToPointChannel");
   m_ndFactory.SetTypeId ("ns3::PointToPointNetDevice");
 }
@@ -105,6 +110,7 @@ FatTreeHelper::Create()
 {
     m_size = m_para->port/2;
     m_fibsize = m_para->fib_size;
+    uint64_t resident = GetResidentBytes();
 
 	const unsigned N = m_size;
 	const unsigned numST = 2*N;
@@ -116,42 +122,54 @@ FatTreeHelper::Create()
 
 	/*
 	 * Create nodes and distribute them into different node container.
-	 * We create 5N^2+2N^3 nodes at a batch, where the first 4N^2 nodes are the
+	 * We create 5N^2+2N^3 nodes, where the first 4N^2 nodes are the
 	 * edge and aggregation switches. In each of the 2N subtrees, first N nodes are
 	 * edges and the remaining N are aggregations. The last N^2 nodes in the
 	 * first 5N^2 nodes are core switches. The last 2N^3 nodes are end hosts.
+	 *
+	 * Every node is created on the system that simulates it: a subtree with its
+	 * hosts lives on one system, and the cores on the systems after those of the
+	 * subtrees. So only the aggr-core links cross systems, and their delay is the
+	 * lookahead of the distributed simulator.
 	 */
 	NS_LOG_LOGIC ("Creating fat-tree nodes.");
-	m_node.Create(numTotal);
+	for(unsigned j=0; j<numST; j++) {
+		m_node.Create(2*N, GetSubtreeSystemId(j));
+	};
+	for(unsigned i=0; i<numCore; i++) {
+		m_node.Create(1, GetCoreSystemId(i));
+	};
+	for(unsigned j=0; j<numST; j++) {
+		m_node.Create(N*N, GetSubtreeSystemId(j));
+	};
 
 	for(unsigned j=0;j<2*N;j++) { // For every subtree
 		for(unsigned i=j*2*N; i<=j*2*N+N-1; i++) { // First N nodes
 		    Ptr<Node> node = m_node.Get(i);
-            node->m_subtreeid = j;
-            node->m_nodetype = 2;
-            node->m_nodeid = i-j*2*N;
+		    SetNodeInfo(node, FAT_TREE_EDGE, j, i-j*2*N);
 			m_edge.Add(node);
 		}
 		for(unsigned i=j*2*N+N; i<=j*2*N+2*N-1; i++) { // Last N nodes
 			Ptr<Node> node = m_node.Get(i);
-            node->m_subtreeid = j;
-            node->m_nodetype = 1;
-            node->m_nodeid = i-j*2*N-N;
+			SetNodeInfo(node, FAT_TREE_AGGR, j, i-j*2*N-N);
 			m_aggr.Add(node);
 		}
 	};
 	for(unsigned i=4*N*N; i<5*N*N; i++) {
 	    Ptr<Node> node = m_node.Get(i);
-	    node->m_subtreeid = 0;
-	    node->m_nodetype = 0;
-	    node->m_nodeid = i-4*N*N;
+	    SetNodeInfo(node, FAT_TREE_CORE, 0, i-4*N*N);
 		m_core.Add(node);
 	};
+	m_nodeToHost.clear();
+	m_hostAddress.assign(numHost, 0);
 	for(unsigned i=5*N*N; i<numTotal; i++) {
 		Ptr<Node> node = m_node.Get(i);
-        node->m_subtreeid = (i-5*N*N)/(N*N);
-        node->m_nodetype = 3;
-        node->m_nodeid = (i-5*N*N)%(N*N);
+		SetNodeInfo(node, FAT_TREE_HOST, (i-5*N*N)/(N*N), (i-5*N*N)%(N*N));
+        if (node->GetId() >= m_nodeToHost.size())
+        {
+            m_nodeToHost.resize(node->GetId()+1, -1);
+        }
+        m_nodeToHost[node->GetId()] = m_host.GetN();
         m_host.Add(node);
 	};
 
@@ -206,7 +224,8 @@ FatTreeHelper::Create()
 				//hr->AddRoute(Ipv4Address(0U), Ipv4Mask(0U), 1);
 				// Set IP address for end host
 				uint32_t address = (((((((10<<7)+j)<<7)+i)<<2)+0x0)<<8)+m;
-				hNode->m_hostaddress = address;
+				m_nodeInfo[hNode->GetId()].m_address = address;
+				m_hostAddress[j*N*N+i*N+m] = address;
 				AssignIP(devices.Get(1), address, m_hostIface);
 				// Set routing for edge switch
 				//hr = hashHelper.GetHashRouting(eNode->GetObject<Ipv4>());
@@ -264,6 +283,10 @@ FatTreeHelper::Create()
 
 	for(unsigned i = 0; i< numTotal; i++) {
 	    Ptr<Node> cur_node = m_node.Get(i);
+	    if (cur_node->GetSystemId() != m_para->systemid)
+	    {
+	        continue;	// Simulated by another system
+	    }
 		Ptr<MixRouting> hr = mixHelper.GetMixRouting(cur_node->GetObject<Ipv4>());
 
 		if (!m_para->enable_cache)
@@ -271,12 +294,25 @@ FatTreeHelper::Create()
             hr->DisableContentRoute();
 		}
 
+		hr->SetNodeInfo(&m_nodeInfo[cur_node->GetId()]);
 		hr->SetNode(cur_node);
-		if (cur_node->m_nodetype != 3)
+		//In the lean mode a switch makes its fib and cache when it first needs them.
+		uint8_t type = m_nodeInfo[cur_node->GetId()].m_type;
+		if (type != FAT_TREE_HOST)
+		{
+		    hr->CreateContentFib(m_fibsize, m_para->lean_topology);
+		}
+		if (m_para->switch_cache_size > 0 &&
+		    ((type == FAT_TREE_EDGE && (m_para->switch_cache_layers & SWITCH_CACHE_EDGE)) ||
+		     (type == FAT_TREE_AGGR && (m_para->switch_cache_layers & SWITCH_CACHE_AGGR))))
 		{
-		    hr->CreateContentFib(m_fibsize);
+		    hr->CreateContentCache(m_para->cache_policy, m_para->switch_cache_size, m_para->lean_topology);
 		}
 	}
+
+	uint64_t grown = GetResidentBytes();
+	m_bytesPerNode = grown > resident ? (double)(grown - resident) / numTotal : 0;
+	NS_LOG_INFO ("Fat-tree of " << numTotal << " nodes, " << m_bytesPerNode << " bytes per node");
 } // FatTreeHelper::Create()
 
 void
@@ -320,4 +356,124 @@ FatTreeHelper::SetContentAttributes(int fibsize)
     m_fibsize = fibsize;
 }
 
+void
+FatTreeHelper::SetNodeInfo(Ptr<Node> node, uint8_t type, unsigned subtree, unsigned id)
+{
+    if (node->GetId() >= m_nodeInfo.size())
+    {
+        m_nodeInfo.resize(node->GetId()+1);
+    }
+    FatTreeNode &info = m_nodeInfo[node->GetId()];
+    info.m_type = type;
+    info.m_subtree = subtree;
+    info.m_id = id;
+    info.m_address = 0;
+}
+
+unsigned
+FatTreeHelper::GetHostID(Ptr<Node> node) const
+{
+    uint32_t id = node->GetId();
+    return id < m_nodeToHost.size() ? m_nodeToHost[id] : -1;
+}
+
+/*
+ * With S systems, the 2N subtrees are split into contiguous blocks over the first
+ * min(S-1, 2N) systems and the cores over the remaining ones. A single system
+ * simulates everything.
+ */
+uint32_t
+FatTreeHelper::GetSubtreeSystemId(unsigned subtree) const
+{
+    const unsigned numST = 2*m_size;
+    if (m_para->systems <= 1)
+    {
+        return 0;
+    }
+    unsigned stSystems = std::min(m_para->systems - 1, numST);
+    return subtree * stSystems / numST;
+}
+
+uint32_t
+FatTreeHelper::GetCoreSystemId(unsigned core) const
+{
+    const unsigned numCore = m_size*m_size;
+    if (m_para->systems <= 1)
+    {
+        return 0;
+    }
+    unsigned stSystems = std::min(m_para->systems - 1, 2*m_size);
+    unsigned coreSystems = m_para->systems - stSystems;
+    return stSystems + core * coreSystems / numCore;
+}
+
+unsigned
+FatTreeHelper::GetHostIDFromAddress(uint32_t address) const
+{
+    // Host addresses are | Subtree ID 7 | 0 | Edge ID 6 | 00 | Host ID 8 |, see Create().
+    const unsigned N = m_size;
+    unsigned subtree = (address >> 17) & 0x7FU;
+    unsigned edge = (address >> 10) & 0x7FU;
+    unsigned port = address & 0xFFU;
+    if ((address & 0x300U) != 0 || subtree >= 2*N || edge >= N || port >= N)
+    {
+        return -1;
+    }
+    unsigned host = subtree*N*N + edge*N + port;
+    return (m_hostAddress[host] == address) ? host : -1;
+}
+
+//Read a "<key>: <n> kB" line of /proc/self/status.
+static uint64_t
+ReadProcStatus(const char *key)
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    size_t len = strlen(key);
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, len, key) == 0 && line.size() > len && line[len] == ':')
+        {
+            return strtoull(line.c_str() + len + 1, 0, 10) * 1024;
+        }
+    }
+    return 0;
+}
+
+uint64_t
+FatTreeHelper::GetResidentBytes()
+{
+    return ReadProcStatus("VmRSS");
+}
+
+uint64_t
+FatTreeHelper::GetPeakResidentBytes()
+{
+    return ReadProcStatus("VmHWM");
+}
+
+Ptr<Node>
+FatTreeHelper::GetDownSwitch(uint32_t address) const
+{
+    // | Subtree ID 7 | 0 | Edge ID 6 | 10 or 01 | Host or Aggr ID 8 |, see Create().
+    const unsigned N = m_size;
+    unsigned subtree = (address >> 17) & 0x7FU;
+    unsigned edge = (address >> 10) & 0x7FU;
+    unsigned port = address & 0xFFU;
+    unsigned type = (address >> 8) & 0x3U;
+    if (subtree >= 2*N || edge >= N || port >= N)
+    {
+        return 0;
+    }
+    if (type == 0x2)
+    {
+        return m_edge.Get(subtree*N + edge);
+    }
+    else if (type == 0x1)
+    {
+        return m_aggr.Get(subtree*N + port);
+    }
+    return 0;
+}
+
 }//namespace
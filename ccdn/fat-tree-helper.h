@@ -21,6 +21,8 @@
 #ifndef FAT_TREE_HELPER_H
 #define FAT_TREE_HELPER_H
 
+#include <vector>
+
 #include "ns3/type-id.h"
 #include "ns3/node-container.h"
 #include "ns3/data-rate.h"
@@ -32,17 +34,11 @@
 #include "ns3/socket.h"
 
 #include "parameter.h"
+#include "fat-tree-node.h"
 
 namespace ns3 {
 
 
-struct CmpHeader
-{
-    uint64_t content;
-    uint32_t version;
-    uint8_t type;
-};
-
 class FatTreeHelper : public Object
 {
 public:
@@ -65,6 +61,31 @@ public:
 
 	void SetContentAttributes(int fibsize);
 
+	// Position of the node in the tree, filled in by Create().
+	const FatTreeNode &GetNodeInfo(Ptr<Node> node) const { return m_nodeInfo[node->GetId()]; };
+
+	// Memory taken by Create(), per node of the tree: resident set growth over the number of nodes.
+	double GetBytesPerNode() const { return m_bytesPerNode; };
+	// Resident set size of this process now, and its peak so far. 0 where /proc is missing.
+	static uint64_t GetResidentBytes();
+	static uint64_t GetPeakResidentBytes();
+
+	// Host index, filled in by Create(). Host IDs are the indices in HostNodes().
+	// Return -1 if the node is not a host.
+	unsigned GetHostID(Ptr<Node> node) const;
+	uint32_t GetHostAddress(unsigned host) const { return m_hostAddress[host]; };
+	// Decode the host ID from the address, and check it. Return -1 if this is not a host address.
+	unsigned GetHostIDFromAddress(uint32_t address) const;
+	// The edge or aggregation switch whose interface toward a host or an edge has the address.
+	// Return 0 for any other address.
+	Ptr<Node> GetDownSwitch(uint32_t address) const;
+
+	// The system (MPI rank) that simulates a subtree or a core, see Create().
+	uint32_t GetSubtreeSystemId(unsigned subtree) const;
+	uint32_t GetCoreSystemId(unsigned core) const;
+	// Whether the host is simulated by this process.
+	bool IsLocalHost(unsigned host) const { return GetSubtreeSystemId(host/(m_size*m_size)) == m_para->systemid; };
+
 	//This is the function of content management protocol
 
 
@@ -72,6 +93,7 @@ private:
 	// Aux functions
 	void	AssignIP (Ptr<NetDevice> c, uint32_t address, Ipv4InterfaceContainer &con);
     NetDeviceContainer InstallND(Ptr<Node> a, Ptr<Node> b);
+    void SetNodeInfo(Ptr<Node> node, uint8_t type, unsigned subtree, unsigned id);
 	// Parameters
 	static unsigned	m_size;		//< This is ugly, but necessary for PathTranslate()
 	DataRate	m_heRate;
@@ -96,6 +118,11 @@ private:
     int m_fibsize;
     Parameter *m_para;
 
+    std::vector<FatTreeNode>	m_nodeInfo;	// Indexed by Node::GetId()
+    std::vector<unsigned>	m_nodeToHost;	// Indexed by Node::GetId()
+    std::vector<uint32_t>	m_hostAddress;	// Indexed by host ID
+    double	m_bytesPerNode;
+
 
 };
 };
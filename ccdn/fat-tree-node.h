@@ -0,0 +1,31 @@
+#ifndef FAT_TREE_NODE_H
+#define FAT_TREE_NODE_H
+
+#include <stdint.h>
+
+namespace ns3
+{
+
+enum FatTreeNodeType
+{
+    FAT_TREE_CORE = 0,
+    FAT_TREE_AGGR = 1,
+    FAT_TREE_EDGE = 2,
+    FAT_TREE_HOST = 3
+};
+
+/*
+ * Where a node sits in the fat-tree. FatTreeHelper keeps one of these per node in an array
+ * indexed by Node::GetId(), 8 bytes each, so ns-3's Node needs no extra fields.
+ */
+struct FatTreeNode
+{
+    uint8_t     m_type;         //One of FatTreeNodeType.
+    uint8_t     m_subtree;      //0 for a core.
+    uint16_t    m_id;           //Within the subtree: edge or aggr index, or host index. Core index for a core.
+    uint32_t    m_address;      //Ipv4 address of a host, 0 for a switch.
+};
+
+};
+
+#endif
@@ -0,0 +1,279 @@
+#include <inttypes.h>
+#include <algorithm>
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/nstime.h"
+#include "ns3/fatal-error.h"
+#include "ns3/ipv4.h"
+#include "ns3/channel.h"
+#include "ns3/data-rate.h"
+#include "ns3/point-to-point-net-device.h"
+
+#include "mix-routing.h"
+#include "fluid-transfer.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE ("FluidTransferEngine");
+
+FluidTransferEngine::FluidTransferEngine(FatTreeHelper *helper)
+{
+    m_helper = helper;
+    m_last = 0;
+    BuildLinks();
+}
+
+FluidTransferEngine::~FluidTransferEngine()
+{
+    for (unsigned i = 0; i < m_flows.size(); i++)
+    {
+        m_flows[i]->m_done.Cancel();
+        delete m_flows[i];
+    }
+}
+
+void
+FluidTransferEngine::BuildLinks()
+{
+    NodeContainer &nodes = m_helper->AllNodes();
+    unsigned links = 0;
+    for (unsigned i = 0; i < nodes.GetN(); i++)
+    {
+        Ptr<Node> node = nodes.Get(i);
+        if (node->GetId() >= m_linkbase.size())
+        {
+            m_linkbase.resize(node->GetId() + 1, 0);
+        }
+        m_linkbase[node->GetId()] = links;
+        links += node->GetObject<Ipv4>()->GetNInterfaces() - 1;
+    }
+
+    m_capacity.assign(links, 0);
+    m_linkpeer.assign(links, Ptr<Node>());
+    for (unsigned i = 0; i < nodes.GetN(); i++)
+    {
+        Ptr<Node> node = nodes.Get(i);
+        Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+        for (uint32_t iface = 1; iface < ipv4->GetNInterfaces(); iface++)
+        {
+            unsigned link = m_linkbase[node->GetId()] + iface - 1;
+            Ptr<NetDevice> dev = ipv4->GetNetDevice(iface);
+            DataRateValue rate;
+            dev->GetAttribute("DataRate", rate);
+            m_capacity[link] = rate.Get().GetBitRate() / 8.0;
+            Ptr<Channel> channel = dev->GetChannel();
+            uint32_t otherEnd = (channel->GetDevice(0) == dev) ? 1 : 0;
+            m_linkpeer[link] = channel->GetDevice(otherEnd)->GetNode();
+        }
+    }
+    m_residual.assign(links, 0);
+    m_count.assign(links, 0);
+    m_carried.assign(links, 0);
+    NS_LOG_INFO("Fluid transfer engine over " << links << " links");
+}
+
+void
+FluidTransferEngine::GetPath(Ptr<Node> node, uint32_t srcaddr, unsigned dst, std::vector<unsigned> &links)
+{
+    uint32_t dstaddr = m_helper->GetHostAddress(dst);
+    Ptr<Node> target = m_helper->HostNodes().Get(dst);
+
+    //Up to the core and down again is 6 links.
+    links.clear();
+    while (node != target && links.size() < 6)
+    {
+        Ptr<MixRouting> routing = DynamicCast<MixRouting>(node->GetObject<Ipv4>()->GetRoutingProtocol());
+        int iface = routing->IpHashLookup(dstaddr, srcaddr);
+        unsigned link = m_linkbase[node->GetId()] + iface - 1;
+        links.push_back(link);
+        node = m_linkpeer[link];
+    }
+    if (node != target)
+    {
+        NS_FATAL_ERROR("FluidTransferEngine: no path from " << Ipv4Address(srcaddr) << " to host " << dst);
+    }
+}
+
+void
+FluidTransferEngine::Start(unsigned src, unsigned dst, uint32_t bytes, uint64_t content, uint32_t version)
+{
+    FluidFlow *flow = new FluidFlow;
+    flow->m_src = src;
+    flow->m_dst = dst;
+    flow->m_content = content;
+    flow->m_version = version;
+    flow->m_remaining = bytes;
+    flow->m_rate = 0;
+    Begin(flow, m_helper->HostNodes().Get(src), m_helper->GetHostAddress(src));
+}
+
+void
+FluidTransferEngine::StartFrom(Ptr<Node> node, unsigned dst, uint32_t bytes, uint64_t content, uint32_t version)
+{
+    FluidFlow *flow = new FluidFlow;
+    flow->m_src = -1;
+    flow->m_dst = dst;
+    flow->m_content = content;
+    flow->m_version = version;
+    flow->m_remaining = bytes;
+    flow->m_rate = 0;
+    Begin(flow, node, node->GetObject<Ipv4>()->GetAddress(1, 0).GetLocal().Get());
+}
+
+void
+FluidTransferEngine::Begin(FluidFlow *flow, Ptr<Node> node, uint32_t srcaddr)
+{
+    GetPath(node, srcaddr, flow->m_dst, flow->m_links);
+    NS_LOG_LOGIC("Flow from " << Ipv4Address(srcaddr) << " to " << flow->m_dst << " over " << flow->m_links.size() << " links");
+
+    Drain();
+    flow->m_index = m_flows.size();
+    m_flows.push_back(flow);
+    if (flow->m_links.empty())
+    {
+        //From a host to itself, nothing crosses the network.
+        flow->m_done = Simulator::ScheduleNow(&ns3::FluidTransferEngine::Finish, this, flow);
+    }
+    Reallocate();
+}
+
+void
+FluidTransferEngine::Drain()
+{
+    double now = Simulator::Now().GetSeconds();
+    double elapsed = now - m_last;
+    m_last = now;
+    if (elapsed <= 0)
+    {
+        return;
+    }
+    for (unsigned i = 0; i < m_flows.size(); i++)
+    {
+        FluidFlow *flow = m_flows[i];
+        double bytes = std::min(flow->m_remaining, flow->m_rate * elapsed);
+        flow->m_remaining -= bytes;
+        for (unsigned j = 0; j < flow->m_links.size(); j++)
+        {
+            m_carried[flow->m_links[j]] += bytes;
+        }
+    }
+}
+
+double
+FluidTransferEngine::GetCarriedBytes(Ptr<Node> node, uint32_t iface)
+{
+    //Draining at any time is fine: the rates, and so the finish times, stay the same.
+    Drain();
+    return m_carried[m_linkbase[node->GetId()] + iface - 1];
+}
+
+/*
+ * Water-filling: the link with the smallest fair share among its unfrozen flows is the
+ * bottleneck of all of them. They get that share, which is taken off every link they
+ * cross, and the next bottleneck is found among the flows left.
+ */
+void
+FluidTransferEngine::Reallocate()
+{
+    m_used.clear();
+    unsigned unfrozen = 0;
+    for (unsigned i = 0; i < m_flows.size(); i++)
+    {
+        FluidFlow *flow = m_flows[i];
+        flow->m_frozen = flow->m_links.empty();
+        unfrozen += flow->m_frozen ? 0 : 1;
+        for (unsigned j = 0; j < flow->m_links.size(); j++)
+        {
+            unsigned link = flow->m_links[j];
+            if (m_count[link] == 0)
+            {
+                m_residual[link] = m_capacity[link];
+                m_used.push_back(link);
+            }
+            m_count[link] ++;
+        }
+    }
+
+    std::vector<double> rates(m_flows.size(), 0);
+    while (unfrozen > 0)
+    {
+        unsigned bottleneck = 0;
+        double share = 0;
+        bool found = false;
+        for (unsigned i = 0; i < m_used.size(); i++)
+        {
+            unsigned link = m_used[i];
+            if (m_count[link] > 0 && (!found || m_residual[link] / m_count[link] < share))
+            {
+                share = m_residual[link] / m_count[link];
+                bottleneck = link;
+                found = true;
+            }
+        }
+        //Every unfrozen flow counts on its links, so there is always a bottleneck.
+        NS_ASSERT_MSG (found, "FluidTransferEngine: " << unfrozen << " flows left without a link");
+        if (!found)
+        {
+            break;
+        }
+
+        for (unsigned i = 0; i < m_flows.size(); i++)
+        {
+            FluidFlow *flow = m_flows[i];
+            if (flow->m_frozen || std::find(flow->m_links.begin(), flow->m_links.end(), bottleneck) == flow->m_links.end())
+            {
+                continue;
+            }
+            flow->m_frozen = true;
+            rates[i] = share;
+            unfrozen --;
+            for (unsigned j = 0; j < flow->m_links.size(); j++)
+            {
+                //Rounding may leave a little less than nothing; a link never has a negative share.
+                unsigned link = flow->m_links[j];
+                m_residual[link] = std::max(m_residual[link] - share, 0.0);
+                m_count[link] --;
+            }
+        }
+    }
+
+    //Only flows whose rate has changed get a new finish event.
+    for (unsigned i = 0; i < m_flows.size(); i++)
+    {
+        FluidFlow *flow = m_flows[i];
+        if (flow->m_done.IsRunning() && rates[i] == flow->m_rate)
+        {
+            continue;
+        }
+        flow->m_rate = rates[i];
+        flow->m_done.Cancel();
+        if (flow->m_rate > 0)
+        {
+            flow->m_done = Simulator::Schedule(Seconds(flow->m_remaining / flow->m_rate), &ns3::FluidTransferEngine::Finish, this, flow);
+        }
+    }
+}
+
+void
+FluidTransferEngine::Finish(FluidFlow *flow)
+{
+    Drain();
+    flow->m_remaining = 0;
+
+    FluidFlow *last = m_flows.back();
+    m_flows[flow->m_index] = last;
+    last->m_index = flow->m_index;
+    m_flows.pop_back();
+    Reallocate();
+
+    NS_LOG_LOGIC("Flow from " << flow->m_src << " to " << flow->m_dst << " finished, " << m_flows.size() << " flows left");
+    if (!TransferFinished.IsNull())
+    {
+        TransferFinished(flow->m_src, flow->m_dst, flow->m_content, flow->m_version);
+    }
+    delete flow;
+}
+
+};
@@ -0,0 +1,90 @@
+#ifndef FLUID_TRANSFER_H
+#define FLUID_TRANSFER_H
+
+#include <inttypes.h>
+#include <vector>
+#include "ns3/callback.h"
+#include "ns3/event-id.h"
+
+#include "fat-tree-helper.h"
+
+namespace ns3
+{
+
+struct FluidFlow
+{
+    unsigned m_src;                 //-1 if a switch sends from its cache.
+    unsigned m_dst;
+    uint64_t m_content;
+    uint32_t m_version;
+    std::vector<unsigned> m_links;  //Directed links of the path, see FluidTransferEngine.
+    double m_remaining;             //Bytes not delivered yet.
+    double m_rate;                  //Bytes per second.
+    bool m_frozen;                  //The rate is fixed in this round of water-filling.
+    unsigned m_index;               //Position in FluidTransferEngine::m_flows.
+    EventId m_done;
+};
+
+/*
+ * A flow-level model of the data transfers, used instead of TCP over packets.
+ *
+ * A transfer is a flow over the path MixRouting::IpHashLookup() picks for its packets. The
+ * flows share every link max-min fairly. Rates are only recomputed by water-filling when a
+ * flow starts or finishes. Each flow then has one pending event, at the time it would finish
+ * at its current rate.
+ *
+ * Links are directed and are numbered by node: link m_linkbase[node] + iface - 1 goes out of
+ * the interface iface of the node.
+ */
+class FluidTransferEngine
+{
+
+public:
+
+    FluidTransferEngine(FatTreeHelper *helper);
+    ~FluidTransferEngine();
+
+    //The function to invoke with (src, dst, content, version) when the last byte is delivered.
+    void SetFinishCallback(Callback<void, unsigned, unsigned, uint64_t, uint32_t> finish) {TransferFinished = finish;};
+
+    //Start sending bytes from host src to host dst.
+    void Start(unsigned src, unsigned dst, uint32_t bytes, uint64_t content, uint32_t version);
+    //Start sending bytes from a switch to host dst. The flow finishes with src -1.
+    void StartFrom(Ptr<Node> node, unsigned dst, uint32_t bytes, uint64_t content, uint32_t version);
+    unsigned GetActiveFlows() const {return m_flows.size();};
+    //Bytes carried so far out of the interface iface of the node.
+    double GetCarriedBytes(Ptr<Node> node, uint32_t iface);
+
+private:
+
+    FluidTransferEngine(const FluidTransferEngine &);
+    FluidTransferEngine &operator = (const FluidTransferEngine &);
+
+    void BuildLinks();
+    void GetPath(Ptr<Node> node, uint32_t srcaddr, unsigned dst, std::vector<unsigned> &links);
+    void Begin(FluidFlow *flow, Ptr<Node> node, uint32_t srcaddr);
+    //Take off the bytes delivered since the last change of rates.
+    void Drain();
+    //Max-min fair rates by water-filling, and the finish events that follow from them.
+    void Reallocate();
+    void Finish(FluidFlow *flow);
+
+    FatTreeHelper *m_helper;
+    std::vector<unsigned> m_linkbase;   //Indexed by Node::GetId()
+    std::vector<double> m_capacity;     //Bytes per second, indexed by link.
+    std::vector<Ptr<Node> > m_linkpeer; //The node at the other end, indexed by link.
+    std::vector<double> m_carried;      //Bytes, indexed by link. Only kept up to date by Drain().
+    std::vector<FluidFlow*> m_flows;
+    double m_last;                      //When the flows were last drained.
+
+    //Water-filling state, indexed by link.
+    std::vector<double> m_residual;
+    std::vector<unsigned> m_count;
+    std::vector<unsigned> m_used;
+
+    Callback<void, unsigned, unsigned, uint64_t, uint32_t> TransferFinished;
+};
+};
+
+
+#endif
@@ -20,15 +20,19 @@
  */
 
 #include <stdlib.h>
+#include <algorithm>
+#include <sstream>
 #include "ns3/inet-socket-address.h"
 #include "ns3/packet.h"
 #include "ns3/log.h"
-#include "ns3/packet-sink-helper.h"
-#include "ns3/application.h"
+#include "ns3/ipv4.h"
 
 #include "data-transfer.h"
+#include "cmp-header.h"
 #include "content-cache.h"
 #include "global-content-manager.h"
+#include "mix-routing.h"
+#include "event-profiler.h"
 
 namespace ns3 {
 
@@ -55,45 +59,134 @@ GlobalContentManager::Create()
     helper->SetPara(m_para);
     helper->Create();
 
-    recorder = new TaskRecorder(m_para->filename);
+    //Each system records the tasks of its own hosts.
+    std::ostringstream filename;
+    filename << m_para->filename;
+    if (m_para->systems > 1)
+    {
+        filename << "." << m_para->systemid;
+    }
+    recorder = new TaskRecorder(filename.str().c_str(), m_para->result_format);
+    recorder->SetReloadCallback(MakeCallback(&ns3::GlobalContentManager::ReloadRequire, this));
+    recorder->SetTimeout(m_para->task_timeout, m_para->task_backoff, m_para->task_max_timeout);
 
-    m_table = new std::vector<ContentTableEntry*>(0);
+    m_fluid = 0;
+    m_transfers = 0;
+    if (m_para->fluid_transfer)
+    {
+        if (m_para->systems > 1)
+        {
+            NS_FATAL_ERROR("Fluid transfers cannot cross systems, run them in one process");
+        }
+        m_fluid = new FluidTransferEngine(helper);
+        m_fluid->SetFinishCallback(MakeCallback(&ns3::GlobalContentManager::FluidTransferFinished, this));
+    }
+    else
+    {
+        m_transfers = new TransferPool(helper, m_dataport);
+        m_transfers->SetReceiveCallback(MakeCallback(&ns3::GlobalContentManager::ContentArrived, this));
+    }
+
+    m_tableIndex = new ContentIndex(1024);
+    m_deadHosts = 0;
 	unsigned numHost = helper->HostNodes().GetN();
 
+	//Caches and sockets are only made for the hosts of this system.
 	m_cache = new ContentCache*[numHost];
+    m_cmpSockets = new Ptr<Socket>[numHost];
+    m_hostRandom.resize(numHost);
 	for(unsigned i = 0; i < numHost; i++)
     {
-        m_cache[i] = new ContentCache(m_para->cache_size);
+        m_cache[i] = 0;
+        m_hostRandom[i].Seed(helper->HostNodes().Get(i)->GetId());
+        if (!m_para->lean_topology)
+        {
+            EnsureHost(i);
+        }
     }
+    //Requests for a content not in the table go to host 0 (see GetContentLocation()), which
+    //must be there to reject them, or the requester would only time out.
+    EnsureHost(0);
 
-    //Create cmp sockets and data receive socket for each host
-    m_cmpSockets = new Ptr<Socket>[numHost];
-    for(unsigned i = 0; i < numHost; i++)
+    //The switches with a cache tell us when they answer a request.
+    NodeContainer switches(helper->EdgeNodes(), helper->AggrNodes());
+    for (unsigned i = 0; i < switches.GetN() && m_para->switch_cache_size > 0; i++)
+    {
+        Ptr<MixRouting> routing = DynamicCast<MixRouting>(switches.Get(i)->GetObject<Ipv4>()->GetRoutingProtocol());
+        if (switches.Get(i)->GetSystemId() == m_para->systemid && routing->HasContentCache())
+        {
+            routing->SetCacheHitCallback(MakeCallback(&ns3::GlobalContentManager::SwitchCacheHit, this));
+        }
+    }
+
+    //Snapshots of the counters go next to the task results.
+    m_metrics = 0;
+    if (m_para->metrics_interval > 0)
     {
-        Ptr<Node> cur_node = helper->HostNodes().Get(i);
-        m_cmpSockets[i] = Socket::CreateSocket (cur_node, TypeId::LookupByName ("ns3::UdpSocketFactory"));
-	    InetSocketAddress dst = InetSocketAddress (Ipv4Address(cur_node->m_hostaddress), m_cmpport);
-	    m_cmpSockets[i]->Bind(dst);
-	    m_cmpSockets[i]->SetRecvCallback(MakeCallback(&ns3::GlobalContentManager::RecvCmpPacket, this));
+        //A snapshot keeps the event queue of its system busy, and the distributed simulator
+        //only finishes when every queue is empty, so the run would never end.
+        if (m_para->systems > 1)
+        {
+            NS_FATAL_ERROR("Metrics snapshots cannot be taken in a distributed run, run it in one process");
+        }
+        filename << ".metrics" << (m_para->metrics_format == METRICS_JSON ? ".json" : ".csv");
+        m_metrics = new MetricsRecorder(this, helper, m_fluid, filename.str().c_str(), m_para->metrics_format, m_para->metrics_interval);
+        m_metrics->Start(m_para->systemid);
+    }
+}
 
-	    InetSocketAddress dst2 = InetSocketAddress (Ipv4Address(cur_node->m_hostaddress), m_dataport);
-	    PacketSinkHelper sink ("ns3::TcpSocketFactory", dst2);
-	    ApplicationContainer apps = sink.Install (cur_node);
-	    apps.Start (Seconds (0.0));
+void
+GlobalContentManager::EnsureHost(unsigned host)
+{
+    if (m_cmpSockets[host] != 0 || !helper->IsLocalHost(host))
+    {
+        return;
+    }
+    m_cache[host] = ContentCache::Create(m_para->cache_policy, m_para->cache_size);
+
+    //Create the cmp socket and accept data connections
+    m_cmpSockets[host] = Socket::CreateSocket (helper->HostNodes().Get(host), TypeId::LookupByName ("ns3::UdpSocketFactory"));
+    InetSocketAddress dst = InetSocketAddress (Ipv4Address(helper->GetHostAddress(host)), m_cmpport);
+    m_cmpSockets[host]->Bind(dst);
+    m_cmpSockets[host]->SetRecvCallback(MakeCallback(&ns3::GlobalContentManager::RecvCmpPacket, this));
+    if (m_transfers != 0)
+    {
+        m_transfers->Listen(host);
     }
 }
 
 void
 GlobalContentManager::CreateContent(uint64_t content, unsigned numHost, unsigned *host)
 {
+    ProfileScope profile(PROFILE_CREATE_CONTENT);
     RemoveContent(content);
-    NS_LOG_LOGIC("Create global content: "<<content<<", currently "<<m_table->size()<<" contents.");
-    ContentTableEntry *entry = new ContentTableEntry;
-    entry->content = content;
-    entry->version = 0;
-    entry->numHost = numHost;
-    entry->host = host;
-    m_table->insert(m_table->begin(), entry);
+    //A replica must be able to answer the requests sent to it.
+    for (unsigned i = 0; i < numHost; i++)
+    {
+        EnsureHost(host[i]);
+    }
+    NS_LOG_LOGIC("Create global content: "<<content<<", currently "<<m_tableIndex->GetSize()<<" contents.");
+    int32_t slot;
+    if (m_tableFree.empty())
+    {
+        slot = m_table.size();
+        m_table.push_back(ContentTableEntry());
+    }
+    else
+    {
+        slot = m_tableFree.back();
+        m_tableFree.pop_back();
+    }
+
+    ContentTableEntry &entry = m_table[slot];
+    entry.content = content;
+    entry.version = 0;
+    entry.numHost = numHost;
+    entry.hostOffset = m_hostPool.size();
+    m_hostPool.insert(m_hostPool.end(), host, host + numHost);
+    //Keep the replicas sorted, which groups them by edge and by subtree. See GetRandomClosestLocation().
+    std::sort(m_hostPool.begin() + entry.hostOffset, m_hostPool.end());
+    m_tableIndex->Insert(content, slot);
 }
 void
 GlobalContentManager::UpdateContent(uint64_t content)
@@ -112,29 +205,61 @@ GlobalContentManager::UpdateContent(uint64_t content)
 void
 GlobalContentManager::RemoveContent(uint64_t content)
 {
-    NS_LOG_LOGIC("Remove global content: "<<content<<", currently "<<m_table->size()<<" contents.");
-    for (std::vector<ContentTableEntry*>::iterator iter = m_table->begin(); iter != m_table->end(); iter ++)
+    NS_LOG_LOGIC("Remove global content: "<<content<<", currently "<<m_tableIndex->GetSize()<<" contents.");
+    int32_t slot = m_tableIndex->Find(content);
+    if (slot == -1)
     {
-        if ((*iter)->content == content)
+        return;
+    }
+
+    m_tableIndex->Erase(content);
+    m_deadHosts += m_table[slot].numHost;
+    m_table[slot].numHost = 0;
+    m_table[slot].hostOffset = -1;
+    m_tableFree.push_back(slot);
+
+    //Don't let replaced replica lists pile up in the pool.
+    if (m_deadHosts > 4096 && m_deadHosts * 2 > m_hostPool.size())
+    {
+        CompactHostPool();
+    }
+}
+void
+GlobalContentManager::CompactHostPool()
+{
+    std::vector<unsigned> pool;
+    pool.reserve(m_hostPool.size() - m_deadHosts);
+    for (std::vector<ContentTableEntry>::iterator iter = m_table.begin(); iter != m_table.end(); iter ++)
+    {
+        if (iter->hostOffset == (unsigned)-1)
         {
-            ContentTableEntry *entry = *iter;
-            m_table->erase(iter);
-            delete entry;
-            return;
+            continue;
         }
+        unsigned offset = pool.size();
+        pool.insert(pool.end(), m_hostPool.begin() + iter->hostOffset, m_hostPool.begin() + iter->hostOffset + iter->numHost);
+        iter->hostOffset = offset;
     }
+    m_hostPool.swap(pool);
+    m_deadHosts = 0;
 }
 ContentTableEntry*
 GlobalContentManager::GetContent(uint64_t content)
 {
-    for (std::vector<ContentTableEntry*>::iterator iter = m_table->begin(); iter != m_table->end(); iter ++)
+    int32_t slot = m_tableIndex->Find(content);
+    if (slot == -1)
     {
-        if ((*iter)->content == content)
-        {
-            return *iter;
-        }
+        return 0;
     }
-    return 0;
+    return &m_table[slot];
+}
+unsigned*
+GlobalContentManager::GetContentHosts(ContentTableEntry *entry)
+{
+    if (entry->numHost == 0)
+    {
+        return 0;
+    }
+    return &m_hostPool[entry->hostOffset];
 }
 bool
 GlobalContentManager::HasContent(unsigned host, uint64_t content)
@@ -145,15 +270,8 @@ GlobalContentManager::HasContent(unsigned host, uint64_t content)
         return false;
     }
 
-	for (unsigned i = 0; i < entry->numHost; i++)
-	{
-		if (entry->host[i] == host)
-		{
-			return true;
-		}
-	}
-
-	return false;
+	unsigned *hosts = GetContentHosts(entry);
+	return std::binary_search(hosts, hosts + entry->numHost, host);
 }
 
 
@@ -168,49 +286,57 @@ GlobalContentManager::GetContentLocation(unsigned local, uint64_t content, uint3
         return 0;
     }
     version = entry->version;
-    NS_LOG_DEBUG(content<<" hit on "<<GetRandomClosestLocation(local, entry->numHost, entry->host));
-	return GetRandomClosestLocation(local, entry->numHost, entry->host);
+    unsigned location = GetRandomClosestLocation(local, entry->numHost, GetContentHosts(entry));
+    NS_LOG_DEBUG(content<<" hit on "<<location);
+	return location;
 }
+/*
+* Host IDs are numbered subtree by subtree and edge by edge, so in a sorted replica list
+* the replicas under one edge, and under one subtree, are next to each other. The closest
+* group is found by binary search, and a member of it is picked with the random stream of
+* the local host, so the choice does not depend on what other hosts do.
+*/
 unsigned
 GlobalContentManager::GetRandomClosestLocation(unsigned local, unsigned numHost, unsigned *host)
 {
-	unsigned min_distance = 8;
-	unsigned min_host = -1;
-	int count = 1;
-	for (unsigned i = 0; i < numHost; i++)
+	if (numHost == 0)
 	{
-		unsigned current_distance = GetHostDistance(local, host[i]);
-		if (current_distance < min_distance)
-		{
-			min_distance = current_distance;
-			min_host = host[i];
-			count = 1;
-		}
-		else if (current_distance == min_distance)
+		return -1;
+	}
+
+	unsigned *end = host + numHost;
+	unsigned *first = std::lower_bound(host, end, local);
+	if (first != end && *first == local)
+	{
+		return local;
+	}
+
+	//Same edge, then same subtree, then anywhere.
+	unsigned group[2] = {N, N*N};
+	for (int i = 0; i < 2; i++)
+	{
+		unsigned base = local / group[i] * group[i];
+		first = std::lower_bound(host, end, base);
+		unsigned *last = std::lower_bound(first, end, base + group[i]);
+		if (first != last)
 		{
-			count ++;
-			if (rand()%count == 0)
-			{
-				min_host = host[i];
-			}
+			return first[m_hostRandom[local].Below(last - first)];
 		}
 	}
-	return min_host;
+	return host[m_hostRandom[local].Below(numHost)];
 }
 unsigned
 GlobalContentManager::GetHostDistance(unsigned a, unsigned b)
 {
-	Ptr<Node> node_a = helper->HostNodes().Get(a);
-	Ptr<Node> node_b = helper->HostNodes().Get(b);
-	if (node_a->m_subtreeid != node_b->m_subtreeid)
+	if (a / (N*N) != b / (N*N))
 	{
 		return 6;
 	}
-	else if (node_a->m_hostaddress>>8 != node_b->m_hostaddress>>8)
+	else if (a / N != b / N)
 	{
 		return 4;
 	}
-	else if (node_a->m_nodeid != node_b->m_nodeid)
+	else if (a != b)
 	{
 		return 2;
 	}
@@ -237,11 +363,86 @@ GlobalContentManager::HasCache(unsigned host, uint64_t content, uint32_t version
 {
 	return m_cache[host]->HasCache(content, version);
 }
+RoutingStats
+GlobalContentManager::GetRoutingStats()
+{
+    RoutingStats stats;
+    NodeContainer switches(helper->EdgeNodes(), helper->AggrNodes(), helper->CoreNodes());
+    for (unsigned i = 0; i < switches.GetN(); i++)
+    {
+        if (switches.Get(i)->GetSystemId() == m_para->systemid)
+        {
+            stats.Add(DynamicCast<MixRouting>(switches.Get(i)->GetObject<Ipv4>()->GetRoutingProtocol())->GetStats());
+        }
+    }
+    return stats;
+}
+FibStats
+GlobalContentManager::GetFibStats(unsigned *entries)
+{
+    FibStats stats;
+    unsigned size = 0;
+    NodeContainer switches(helper->EdgeNodes(), helper->AggrNodes(), helper->CoreNodes());
+    for (unsigned i = 0; i < switches.GetN(); i++)
+    {
+        if (switches.Get(i)->GetSystemId() != m_para->systemid)
+        {
+            continue;
+        }
+        Ptr<MixRouting> routing = DynamicCast<MixRouting>(switches.Get(i)->GetObject<Ipv4>()->GetRoutingProtocol());
+        stats.Add(routing->GetFibStats());
+        size += routing->GetFibSize();
+    }
+    if (entries != 0)
+    {
+        *entries = size;
+    }
+    return stats;
+}
+CacheStats
+GlobalContentManager::GetSwitchCacheStats()
+{
+    CacheStats stats;
+    NodeContainer switches(helper->EdgeNodes(), helper->AggrNodes());
+    for (unsigned i = 0; i < switches.GetN(); i++)
+    {
+        if (switches.Get(i)->GetSystemId() != m_para->systemid)
+        {
+            continue;
+        }
+        Ptr<MixRouting> routing = DynamicCast<MixRouting>(switches.Get(i)->GetObject<Ipv4>()->GetRoutingProtocol());
+        if (routing->GetContentCache() != 0)
+        {
+            stats.Add(routing->GetContentCache()->GetStats());
+        }
+    }
+    return stats;
+}
+CacheStats
+GlobalContentManager::GetCacheStats()
+{
+    CacheStats stats;
+    for (unsigned i = 0; i < helper->HostNodes().GetN(); i++)
+    {
+        if (m_cache[i] != 0)
+        {
+            stats.Add(m_cache[i]->GetStats());
+        }
+    }
+    return stats;
+}
 
 
 void
 GlobalContentManager::RequireFile(unsigned host, uint64_t content)
 {
+    ProfileScope profile(PROFILE_REQUIRE_FILE);
+    //Every system replays the whole trace, but only accesses its own hosts.
+    if (!helper->IsLocalHost(host))
+    {
+        return;
+    }
+    EnsureHost(host);
     recorder->RegisterTask(host, content);
     ReloadRequire(host, content);
 }
@@ -250,7 +451,7 @@ GlobalContentManager::ReloadRequire(unsigned host, uint64_t content)
 {
     unsigned version = 0;
     unsigned remote = GetContentLocation(host, content, version);
-    SendCmpPacket(m_cmpSockets[host], content, version, 1, Ipv4Address(helper->HostNodes().Get(remote)->m_hostaddress));
+    SendCmpPacket(m_cmpSockets[host], content, version, 1, Ipv4Address(helper->GetHostAddress(remote)));
 }
 void
 GlobalContentManager::ReviewFile()
@@ -260,15 +461,15 @@ GlobalContentManager::ReviewFile()
 
 
 void
-GlobalContentManager::SendCmpPacket(Ptr<Socket> socket, uint64_t content, uint32_t version, uint8_t type, Ipv4Address dstaddr)
+GlobalContentManager::SendCmpPacket(Ptr<Socket> socket, uint64_t content, uint32_t version, uint8_t type, Ipv4Address dstaddr, uint8_t flags)
 {
-    CmpHeader *header = new CmpHeader;
-    header->content = content;
-    header->version = version;
-    header->type = type;
-    Ptr<Packet> p = ns3::Create<Packet>((uint8_t*)header, sizeof(CmpHeader));
+    Ptr<Packet> p = ns3::Create<Packet>();
+    p->AddHeader(CmpHeader(content, version, type, flags));
+    if (type < CmpHeader::m_types)
+    {
+        m_cmpstats.sent[type] ++;
+    }
     socket->SendTo (p, 0, InetSocketAddress (dstaddr, m_cmpport));
-    delete header;
 }
 
 /*
@@ -278,82 +479,138 @@ GlobalContentManager::SendCmpPacket(Ptr<Socket> socket, uint64_t content, uint32
 void
 GlobalContentManager::RecvCmpPacket(Ptr<Socket> socket)
 {
+	ProfileScope profile(PROFILE_RECV_CMP);
 	Address from;
     Ptr<Packet> packet = socket->RecvFrom (from);
     packet->RemoveAllPacketTags ();
     packet->RemoveAllByteTags ();
-    CmpHeader *header = new CmpHeader;
-    packet->CopyData((uint8_t*)header, sizeof(CmpHeader));
+    CmpHeader header;
+    packet->RemoveHeader(header);
 	unsigned local = GetHostIDFromPtr(socket->GetNode());
+	if (header.GetType() < CmpHeader::m_types)
+	{
+	    m_cmpstats.received[header.GetType()] ++;
+	}
+
+	bool ondisk, incache;
+	unsigned remote;
 
-	NS_LOG_LOGIC("Global receive cmp packet from " << InetSocketAddress::ConvertFrom(from).GetIpv4() <<" to " << Ipv4Address(socket->GetNode()->m_hostaddress) << " with type " << header->type);
+	NS_LOG_LOGIC("Global receive cmp packet from " << InetSocketAddress::ConvertFrom(from).GetIpv4() <<" to " << Ipv4Address(helper->GetHostAddress(local)) << " with type " << (unsigned)header.GetType());
 
-	switch (header->type)
+	switch (header.GetType())
 	{
 	case 0: // Transfer finish. You send a finish and update your cache.
-	    AddCache(local, header->content, header->version);
-        SendCmpPacket(socket, header->content, header->version, 3, InetSocketAddress::ConvertFrom(from).GetIpv4());
+	    ContentArrived(local, GetHostIDFromAddress(InetSocketAddress::ConvertFrom(from).GetIpv4()), header.GetContent(), header.GetVersion());
 		break;
 	case 1: // Request. Check if you have the content. If do, reply; otherwise reject.
 		//First check if there is the content on the disk or on the cache
-		if (HasContent(local, header->content) || (HasCache(local, header->content, header->version) && enable_cache))
+		ondisk = HasContent(local, header.GetContent());
+		incache = !ondisk && HasCache(local, header.GetContent(), header.GetVersion()) && enable_cache;
+		if (ondisk || incache)
 		{
-			SendCmpPacket(socket, header->content, header->version, 2, InetSocketAddress::ConvertFrom(from).GetIpv4());		//Send a reply packet
-			recorder->UpdateTask(GetHostIDFromAddress(InetSocketAddress::ConvertFrom(from).GetIpv4()), local, header->content);
-			TransferContent(local, InetSocketAddress::ConvertFrom(from).GetIpv4(), header->content, header->version);
+			SendCmpPacket(socket, header.GetContent(), header.GetVersion(), 2, InetSocketAddress::ConvertFrom(from).GetIpv4(), incache ? CMP_FLAG_CACHED : 0);		//Send a reply packet
+			TransferContent(local, InetSocketAddress::ConvertFrom(from).GetIpv4(), header.GetContent(), header.GetVersion());
 		}
 		else
 		{
-			SendCmpPacket(socket, header->content, header->version, 4, InetSocketAddress::ConvertFrom(from).GetIpv4());		//This is an reject packet
+			SendCmpPacket(socket, header.GetContent(), header.GetVersion(), 4, InetSocketAddress::ConvertFrom(from).GetIpv4());		//This is an reject packet
 		}
 		break;
-	case 2: //Accept. Currently, Nothing to be done here.
+	case 2: //Accept. The task is handled by the sender.
+		if (header.GetFlags() & CMP_FLAG_SWITCH)
+		{
+			//The switch replies from its interface toward us.
+			Ptr<Node> node = helper->GetDownSwitch(InetSocketAddress::ConvertFrom(from).GetIpv4().Get());
+			NS_ASSERT_MSG(node != 0, "GlobalContentManager: switch reply from " << InetSocketAddress::ConvertFrom(from).GetIpv4());
+			recorder->UpdateTask(local, node->GetId(), header.GetContent(), helper->GetNodeInfo(node).m_type == FAT_TREE_EDGE ? 1 : 2, 2);
+			break;
+		}
+		remote = GetHostIDFromAddress(InetSocketAddress::ConvertFrom(from).GetIpv4());
+		recorder->UpdateTask(local, remote, header.GetContent(), GetHostDistance(remote, local), (header.GetFlags() & CMP_FLAG_CACHED) ? 1 : 0);
 		break;
 	case 3: //Finish. Currently, nothing to be done.
 		break;
-	case 4: //Reject. You need to resend.
-        uint32_t version;
-		SendCmpPacket(socket, header->content, header->version, 1, Ipv4Address(helper->HostNodes().Get(GetContentLocation(local, header->content, version))->m_hostaddress));
+	case 4: //Reject. You need to resend, unless the task has been handled meanwhile.
+		recorder->RetryTask(local, header.GetContent());
 	}
 
-    delete header;
 }
 void
 GlobalContentManager::TransferContent(unsigned local, Ipv4Address dst, uint64_t content, uint32_t version)
 {
-    Ptr<Socket> sendSocket = Socket::CreateSocket(helper->HostNodes().Get(local), TypeId::LookupByName ("ns3::TcpSocketFactory"));
-    //sendSocket->TraceConnectWithoutContext("CongestionWindow", MakeCallback(&cwndTrace));
-    sendSocket->Bind();
-    NS_LOG_LOGIC("From "<<Ipv4Address(helper->HostNodes().Get(local)->m_hostaddress)<<" to "<<dst<<": Transfer started.");
-    DataTransfer *transfer = new DataTransfer(this, m_datasize, local, sendSocket, dst, m_dataport);
-    transfer->SetContent(content, version);
-    transfer->Start();
+    if (m_fluid != 0)
+    {
+        NS_LOG_LOGIC("From "<<Ipv4Address(helper->GetHostAddress(local))<<" to "<<dst<<": Fluid transfer started.");
+        m_fluid->Start(local, GetHostIDFromAddress(dst), m_datasize, content, version);
+        return;
+    }
+    NS_LOG_LOGIC("From "<<Ipv4Address(helper->GetHostAddress(local))<<" to "<<dst<<": Transfer started.");
+    m_transfers->Transfer(local, GetHostIDFromAddress(dst), m_datasize, content, version);
 }
 void
 GlobalContentManager::InvokeTransferFinished(unsigned local, uint64_t content, uint32_t version, Ipv4Address dstaddr)
 {
-    NS_LOG_LOGIC("From "<<Ipv4Address(helper->HostNodes().Get(local)->m_hostaddress)<<" to "<<dstaddr<<": Transfer finished.");
-    recorder->FinishTask(GetHostIDFromAddress(dstaddr), content);
+    NS_LOG_LOGIC("From "<<Ipv4Address(helper->GetHostAddress(local))<<" to "<<dstaddr<<": Transfer finished.");
     SendCmpPacket(m_cmpSockets[local], content, version, 0, dstaddr);
 }
+/*
+* The requester has the whole content, either told by a finish packet (fluid transfers) or
+* by the end of its frame on the data connection. Update the cache and acknowledge it.
+* A switch (remote -1) needs no finish.
+*/
+void
+GlobalContentManager::ContentArrived(unsigned local, unsigned remote, uint64_t content, uint32_t version)
+{
+    recorder->FinishTask(local, content);
+    AddCache(local, content, version);
+    if (remote != (unsigned)-1)
+    {
+        SendCmpPacket(m_cmpSockets[local], content, version, 3, Ipv4Address(helper->GetHostAddress(remote)));
+    }
+}
+void
+GlobalContentManager::FluidTransferFinished(unsigned local, unsigned remote, uint64_t content, uint32_t version)
+{
+    if (local == (unsigned)-1)
+    {
+        ContentArrived(remote, local, content, version);
+        return;
+    }
+    InvokeTransferFinished(local, content, version, Ipv4Address(helper->GetHostAddress(remote)));
+}
+void
+GlobalContentManager::SwitchCacheHit(Ptr<Node> node, uint32_t requester, uint64_t content, uint32_t version)
+{
+    Ptr<Socket> &socket = m_switchSockets[node->GetId()];
+    if (socket == 0)
+    {
+        socket = Socket::CreateSocket (node, TypeId::LookupByName ("ns3::UdpSocketFactory"));
+        socket->Bind ();
+    }
+    unsigned host = GetHostIDFromAddress(Ipv4Address(requester));
+    NS_LOG_LOGIC("Switch " << node->GetId() << " serves " << content << " to " << Ipv4Address(requester) << " from its cache.");
+    SendCmpPacket(socket, content, version, 2, Ipv4Address(requester), CMP_FLAG_CACHED | CMP_FLAG_SWITCH);
+    if (m_fluid != 0)
+    {
+        m_fluid->StartFrom(node, host, m_datasize, content, version);
+    }
+    else
+    {
+        m_transfers->TransferFrom(node, host, m_datasize, content, version);
+    }
+}
 
 unsigned
 GlobalContentManager::GetHostIDFromPtr(Ptr<Node> host)
 {
-	unsigned numHost = helper->HostNodes().GetN();
-	for (unsigned i = 0; i < numHost; i++)
-	{
-		if (host == helper->HostNodes().Get(i))
-		{
-			return i;
-		}
-	}
-	return -1;
+	return helper->GetHostID(host);
 }
 unsigned
 GlobalContentManager::GetHostIDFromAddress(Ipv4Address addr)
 {
-    return addr.Get()%0x100U + ((addr.Get()>>10)%0x80U)*N + ((addr.Get()>>17)%0x80U)*N*N;
+    unsigned host = helper->GetHostIDFromAddress(addr.Get());
+    NS_ASSERT_MSG(host != (unsigned)-1, "GlobalContentManager: " << addr << " is not a host address");
+    return host;
 }
 Ptr<Socket>
 GlobalContentManager::GetCmpSocket(int index)
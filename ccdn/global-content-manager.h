@@ -21,6 +21,7 @@
 #ifndef GLOBAL_CONTENT_MANAGER_H
 #define GLOBAL_CONTENT_MANAGER_H
 
+#include <map>
 #include <vector>
 
 #include "ns3/type-id.h"
@@ -33,9 +34,16 @@
 #include "ns3/socket.h"
 
 #include "parameter.h"
+#include "content-index.h"
+#include "node-random.h"
 #include "content-cache.h"
 #include "fat-tree-helper.h"
 #include "task-recorder.h"
+#include "fluid-transfer.h"
+#include "data-transfer.h"
+#include "metrics-recorder.h"
+#include "cmp-header.h"
+#include "mix-routing.h"
 
 namespace ns3 {
 
@@ -45,7 +53,7 @@ struct ContentTableEntry{
     uint64_t content;
     uint32_t version;
     unsigned numHost;
-    unsigned *host;
+    unsigned hostOffset;    //Where the sorted replica hosts start in the host pool. -1 if the entry is unused.
 
 };
 
@@ -58,34 +66,56 @@ public:
 	virtual ~GlobalContentManager();
 	void SetPara(Parameter *para) {m_para = para;};
 	void Create(void);
+	TaskRecorder *GetTaskRecorder(void) {return recorder;};
 
     //The following functions is to operate the content table, or visit it.
+	//The hosts are copied into the table, so the caller keeps the ownership of the array.
 	void CreateContent(uint64_t content, unsigned numHost, unsigned *hosts);
 	void UpdateContent(uint64_t content);
 	void RemoveContent(uint64_t content);
 	bool HasContent(unsigned host, uint64_t content);
+	//The entry is only valid until the next content is created or removed.
 	ContentTableEntry *GetContent(uint64_t content);
+	unsigned *GetContentHosts(ContentTableEntry *entry);
 	//The closest one will be returned. If there are multiple, then randomly return one.
 	unsigned GetContentLocation(unsigned local, uint64_t content, uint32_t &version);
+	//The hosts must be sorted, as the content table keeps them.
 	unsigned GetRandomClosestLocation(unsigned local, unsigned numHost, unsigned *host);
+	//The number of links between two hosts, computed from their IDs.
 	unsigned GetHostDistance(unsigned a, unsigned b);
 
 	//The following functions is to operate the cache.
 	bool AddCache(unsigned host, uint64_t content, uint32_t version);
 	bool RemoveCache(unsigned host, uint64_t content);
 	bool HasCache(unsigned host, uint64_t content, uint32_t version);
-
-	//The following functions is to invoke an file access operation;
+	//Summed over the caches of the hosts of this system.
+	CacheStats GetCacheStats();
+	//Summed over the on-path caches of the switches of this system.
+	CacheStats GetSwitchCacheStats();
+	//Summed over the switches of this system. entries, if given, gets the number of fib entries.
+	RoutingStats GetRoutingStats();
+	FibStats GetFibStats(unsigned *entries = 0);
+	//Of the hosts and switches of this system.
+	const CmpStats &GetCmpStats() const {return m_cmpstats;};
+	FatTreeHelper *GetHelper() {return helper;};
+
+	//The following functions is to invoke an file access operation. Accesses of hosts
+	//simulated by other systems are ignored.
 	void RequireFile(unsigned host, uint64_t content);
 	void ReloadRequire(unsigned host, uint64_t content);
 	void ReviewFile();
 
 	//The following functions is for cmp
-	void SendCmpPacket(Ptr<Socket> socket, uint64_t content, uint32_t version, uint8_t type, Ipv4Address dstaddr);
+	//flags are CmpFlag bits.
+	void SendCmpPacket(Ptr<Socket> socket, uint64_t content, uint32_t version, uint8_t type, Ipv4Address dstaddr, uint8_t flags = 0);
 	void RecvCmpPacket(Ptr<Socket> socket);
 	Ptr<Socket> GetCmpSocket(int index);
 	void TransferContent(unsigned local, Ipv4Address dst, uint64_t content, uint32_t version);
 	void InvokeTransferFinished(unsigned local, uint64_t content, uint32_t version, Ipv4Address dstaddr);
+	void ContentArrived(unsigned local, unsigned remote, uint64_t content, uint32_t version);
+	void FluidTransferFinished(unsigned local, unsigned remote, uint64_t content, uint32_t version);
+	//A switch answers a request from its cache: it replies and sends the content itself.
+	void SwitchCacheHit(Ptr<Node> node, uint32_t requester, uint64_t content, uint32_t version);
 
 
 	//The following functions should be triggered when a file access is invoked, or the file is found.
@@ -94,12 +124,27 @@ private:
 
 	unsigned GetHostIDFromPtr(Ptr<Node> host);
 	unsigned GetHostIDFromAddress(Ipv4Address addr);
-
-    std::vector<ContentTableEntry*> *m_table;
+	void CompactHostPool();
+	//Make the cache, cmp socket and data listener of a host of this system, if not made yet.
+	//With Parameter::lean_topology this waits until the host first takes part in a task.
+	void EnsureHost(unsigned host);
+
+    //The content table: entries are found by the index, replica hosts of all entries share one pool.
+    std::vector<ContentTableEntry> m_table;
+    std::vector<int32_t> m_tableFree;
+    ContentIndex *m_tableIndex;
+    std::vector<unsigned> m_hostPool;
+    unsigned m_deadHosts;       //Pool slots left behind by removed contents.
     ContentCache* *m_cache;
     Ptr<Socket> *m_cmpSockets;
+    std::vector<NodeRandom> m_hostRandom;   //Picks among equally close replicas, by host ID.
+    CmpStats m_cmpstats;
+    std::map<uint32_t, Ptr<Socket> > m_switchSockets;  //Cmp sockets of the caching switches, by Node::GetId().
     FatTreeHelper *helper;
     TaskRecorder *recorder;
+    FluidTransferEngine *m_fluid;   //0 if the transfers go over TCP.
+    TransferPool *m_transfers;      //0 if the transfers are fluid.
+    MetricsRecorder *m_metrics;     //0 if no snapshots are taken.
     unsigned N;
     Parameter *m_para;
 
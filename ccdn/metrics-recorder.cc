@@ -0,0 +1,278 @@
+#include <inttypes.h>
+#include <string.h>
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/nstime.h"
+#include "ns3/fatal-error.h"
+#include "ns3/ipv4.h"
+#include "ns3/channel.h"
+#include "ns3/data-rate.h"
+#include "ns3/callback.h"
+#include "ns3/point-to-point-net-device.h"
+
+#include "global-content-manager.h"
+#include "fat-tree-helper.h"
+#include "fluid-transfer.h"
+#include "metrics-recorder.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE ("MetricsRecorder");
+
+static const char *g_counterNames[METRIC_COUNTERS] =
+{
+    "tasks", "requests", "replies", "rejects", "routed", "routed_fib",
+    "fib_lookups", "fib_hits", "fib_insertions", "fib_evictions",
+    "cache_lookups", "cache_hits", "cache_evictions",
+    "switch_lookups", "switch_hits", "switch_evictions",
+    "bytes_host", "bytes_edge", "bytes_aggr"
+};
+
+enum MetricsRatio
+{
+    RATIO_REJECT = 0,       //Rejects per request.
+    RATIO_ROUTED_FIB,       //Requests routed by the fib per request routed by content.
+    RATIO_FIB_HIT,
+    RATIO_CACHE_HIT,
+    RATIO_SWITCH_HIT,
+    RATIO_UTIL_HOST,        //Bits carried over the capacity of the layer in the interval.
+    RATIO_UTIL_EDGE,
+    RATIO_UTIL_AGGR,
+    METRIC_RATIOS
+};
+
+static const char *g_ratioNames[METRIC_RATIOS] =
+{
+    "reject_ratio", "routed_fib_ratio", "fib_hit_ratio", "cache_hit_ratio", "switch_hit_ratio",
+    "util_host", "util_edge", "util_aggr"
+};
+
+int
+MetricsFormatFromName(const char *name)
+{
+    if (strcmp(name, "csv") == 0) return METRICS_CSV;
+    if (strcmp(name, "json") == 0) return METRICS_JSON;
+    return -1;
+}
+
+static double
+Ratio(uint64_t part, uint64_t whole)
+{
+    return whole > 0 ? (double)part / whole : 0;
+}
+
+MetricsRecorder::MetricsRecorder(GlobalContentManager *manager, FatTreeHelper *helper, FluidTransferEngine *fluid,
+                                 const char *filename, unsigned format, double interval)
+    : m_file(filename, std::ios::out | std::ios::trunc)
+{
+    if (!m_file)
+    {
+        NS_FATAL_ERROR("Cannot open the metrics output " << filename);
+    }
+    m_manager = manager;
+    m_helper = helper;
+    m_fluid = fluid;
+    m_format = format;
+    m_interval = interval;
+    m_lasttime = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        m_linkbytes[i] = 0;
+        m_capacity[i] = 0;
+    }
+    for (int i = 0; i < METRIC_COUNTERS; i++)
+    {
+        m_last[i] = 0;
+    }
+}
+
+MetricsRecorder::~MetricsRecorder()
+{
+    m_snapshot.Cancel();
+}
+
+void
+MetricsRecorder::CountBytes(uint64_t *bytes, Ptr<const Packet> p)
+{
+    *bytes += p->GetSize();
+}
+
+void
+MetricsRecorder::Start(unsigned systemid)
+{
+    //Every device of this system counts the bytes it sends into the layer of its link.
+    NodeContainer &nodes = m_helper->AllNodes();
+    for (unsigned i = 0; i < nodes.GetN(); i++)
+    {
+        Ptr<Node> node = nodes.Get(i);
+        if (node->GetSystemId() != systemid)
+        {
+            continue;
+        }
+        unsigned type = m_helper->GetNodeInfo(node).m_type;
+        Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+        for (uint32_t iface = 1; iface < ipv4->GetNInterfaces(); iface++)
+        {
+            Ptr<NetDevice> dev = ipv4->GetNetDevice(iface);
+            Ptr<Channel> channel = dev->GetChannel();
+            Ptr<Node> peer = channel->GetDevice(channel->GetDevice(0) == dev ? 1 : 0)->GetNode();
+            unsigned peertype = m_helper->GetNodeInfo(peer).m_type;
+
+            Link link;
+            link.m_node = node;
+            link.m_iface = iface;
+            link.m_layer = (type == FAT_TREE_HOST || peertype == FAT_TREE_HOST) ? 0
+                         : (type == FAT_TREE_CORE || peertype == FAT_TREE_CORE) ? 2 : 1;
+            m_links.push_back(link);
+
+            DataRateValue rate;
+            dev->GetAttribute("DataRate", rate);
+            m_capacity[link.m_layer] += rate.Get().GetBitRate();
+            dev->TraceConnectWithoutContext("PhyTxBegin", MakeBoundCallback(&MetricsRecorder::CountBytes, &m_linkbytes[link.m_layer]));
+        }
+    }
+
+    if (m_format == METRICS_CSV)
+    {
+        m_file << "time";
+        for (int i = 0; i < METRIC_COUNTERS; i++)
+        {
+            m_file << "," << g_counterNames[i];
+        }
+        for (int i = 0; i < METRIC_RATIOS; i++)
+        {
+            m_file << "," << g_ratioNames[i];
+        }
+        m_file << ",pending,fib_entries\n";
+    }
+
+    m_lasttime = Simulator::Now().GetSeconds();
+    m_snapshot = Simulator::Schedule(Seconds(m_interval), &ns3::MetricsRecorder::Snapshot, this);
+    Simulator::ScheduleDestroy(&ns3::MetricsRecorder::Close, this);
+}
+
+void
+MetricsRecorder::Collect(uint64_t *counters, unsigned &fibentries)
+{
+    const CmpStats &cmp = m_manager->GetCmpStats();
+    RoutingStats routing = m_manager->GetRoutingStats();
+    FibStats fib = m_manager->GetFibStats(&fibentries);
+    CacheStats cache = m_manager->GetCacheStats();
+    CacheStats switches = m_manager->GetSwitchCacheStats();
+
+    counters[METRIC_TASKS] = m_manager->GetTaskRecorder()->GetSummary().tasks;
+    counters[METRIC_REQUESTS] = cmp.sent[1];
+    counters[METRIC_REPLIES] = cmp.received[2];
+    counters[METRIC_REJECTS] = cmp.received[4];
+    counters[METRIC_ROUTED] = routing.requests;
+    counters[METRIC_ROUTED_FIB] = routing.fibhits;
+    counters[METRIC_FIB_LOOKUPS] = fib.lookups;
+    counters[METRIC_FIB_HITS] = fib.hits;
+    counters[METRIC_FIB_INSERTIONS] = fib.insertions;
+    counters[METRIC_FIB_EVICTIONS] = fib.evictions;
+    counters[METRIC_CACHE_LOOKUPS] = cache.lookups;
+    counters[METRIC_CACHE_HITS] = cache.hits;
+    counters[METRIC_CACHE_EVICTIONS] = cache.evictions;
+    counters[METRIC_SWITCH_LOOKUPS] = switches.lookups;
+    counters[METRIC_SWITCH_HITS] = switches.hits;
+    counters[METRIC_SWITCH_EVICTIONS] = switches.evictions;
+
+    //Fluid transfers send no data packets; their bytes are kept by the engine.
+    double fluid[3] = {0, 0, 0};
+    for (unsigned i = 0; i < m_links.size() && m_fluid != 0; i++)
+    {
+        fluid[m_links[i].m_layer] += m_fluid->GetCarriedBytes(m_links[i].m_node, m_links[i].m_iface);
+    }
+    for (int l = 0; l < 3; l++)
+    {
+        counters[METRIC_BYTES_HOST + l] = m_linkbytes[l] + (uint64_t)fluid[l];
+    }
+}
+
+void
+MetricsRecorder::Snapshot()
+{
+    Take();
+    //Stop with the rest of the simulation, or Simulator::Run() would never return. This only
+    //works in one process; GlobalContentManager refuses snapshots in a distributed run.
+    if (!Simulator::IsFinished())
+    {
+        m_snapshot = Simulator::Schedule(Seconds(m_interval), &ns3::MetricsRecorder::Snapshot, this);
+    }
+}
+
+void
+MetricsRecorder::Take()
+{
+    double now = Simulator::Now().GetSeconds();
+    double elapsed = now - m_lasttime;
+    uint64_t counters[METRIC_COUNTERS];
+    uint64_t delta[METRIC_COUNTERS];
+    unsigned fibentries = 0;
+    Collect(counters, fibentries);
+    for (int i = 0; i < METRIC_COUNTERS; i++)
+    {
+        delta[i] = counters[i] - m_last[i];
+        m_last[i] = counters[i];
+    }
+
+    double ratio[METRIC_RATIOS];
+    ratio[RATIO_REJECT] = Ratio(delta[METRIC_REJECTS], delta[METRIC_REQUESTS]);
+    ratio[RATIO_ROUTED_FIB] = Ratio(delta[METRIC_ROUTED_FIB], delta[METRIC_ROUTED]);
+    ratio[RATIO_FIB_HIT] = Ratio(delta[METRIC_FIB_HITS], delta[METRIC_FIB_LOOKUPS]);
+    ratio[RATIO_CACHE_HIT] = Ratio(delta[METRIC_CACHE_HITS], delta[METRIC_CACHE_LOOKUPS]);
+    ratio[RATIO_SWITCH_HIT] = Ratio(delta[METRIC_SWITCH_HITS], delta[METRIC_SWITCH_LOOKUPS]);
+    for (int l = 0; l < 3; l++)
+    {
+        double capacity = m_capacity[l] * elapsed;
+        ratio[RATIO_UTIL_HOST + l] = capacity > 0 ? delta[METRIC_BYTES_HOST + l] * 8.0 / capacity : 0;
+    }
+
+    Write(now, delta, ratio, m_manager->GetTaskRecorder()->GetPendingTasks(), fibentries);
+    m_lasttime = now;
+}
+
+void
+MetricsRecorder::Write(double now, const uint64_t *delta, const double *ratio, unsigned pending, unsigned fibentries)
+{
+    if (m_format == METRICS_CSV)
+    {
+        m_file << now;
+        for (int i = 0; i < METRIC_COUNTERS; i++)
+        {
+            m_file << "," << delta[i];
+        }
+        for (int i = 0; i < METRIC_RATIOS; i++)
+        {
+            m_file << "," << ratio[i];
+        }
+        m_file << "," << pending << "," << fibentries << "\n";
+        return;
+    }
+
+    m_file << "{\"time\":" << now;
+    for (int i = 0; i < METRIC_COUNTERS; i++)
+    {
+        m_file << ",\"" << g_counterNames[i] << "\":" << delta[i];
+    }
+    for (int i = 0; i < METRIC_RATIOS; i++)
+    {
+        m_file << ",\"" << g_ratioNames[i] << "\":" << ratio[i];
+    }
+    m_file << ",\"pending\":" << pending << ",\"fib_entries\":" << fibentries << "}\n";
+}
+
+void
+MetricsRecorder::Close()
+{
+    //The part of the last interval that was simulated.
+    m_snapshot.Cancel();
+    if (Simulator::Now().GetSeconds() > m_lasttime)
+    {
+        Take();
+    }
+    m_file.close();
+}
+
+};
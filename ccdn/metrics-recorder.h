@@ -0,0 +1,110 @@
+#ifndef METRICS_RECORDER_H
+#define METRICS_RECORDER_H
+
+#include <inttypes.h>
+#include <fstream>
+#include <vector>
+#include "ns3/ptr.h"
+#include "ns3/packet.h"
+#include "ns3/node.h"
+#include "ns3/event-id.h"
+
+namespace ns3
+{
+
+class GlobalContentManager;
+class FatTreeHelper;
+class FluidTransferEngine;
+
+enum MetricsFormat
+{
+    METRICS_CSV = 0,        //A header line, then one line per snapshot.
+    METRICS_JSON = 1        //One JSON object per line and snapshot.
+};
+
+//Return the MetricsFormat of a name (csv, json), or -1 if there is no such format.
+int MetricsFormatFromName(const char *name);
+
+//Counters summed over this system. A snapshot writes how much each grew in the interval.
+enum MetricsCounter
+{
+    METRIC_TASKS = 0,           //Tasks finished.
+    METRIC_REQUESTS,            //Requests sent by the hosts, retries included.
+    METRIC_REPLIES,             //Replies received by the hosts.
+    METRIC_REJECTS,             //Rejects received by the hosts.
+    METRIC_ROUTED,              //Requests routed by content in the switches.
+    METRIC_ROUTED_FIB,          //Of them, sent where the fib points.
+    METRIC_FIB_LOOKUPS,
+    METRIC_FIB_HITS,
+    METRIC_FIB_INSERTIONS,
+    METRIC_FIB_EVICTIONS,
+    METRIC_CACHE_LOOKUPS,       //Host caches.
+    METRIC_CACHE_HITS,
+    METRIC_CACHE_EVICTIONS,
+    METRIC_SWITCH_LOOKUPS,      //On-path caches of the switches.
+    METRIC_SWITCH_HITS,
+    METRIC_SWITCH_EVICTIONS,
+    METRIC_BYTES_HOST,          //Bytes over the host-edge links, both ways.
+    METRIC_BYTES_EDGE,          //Edge-aggr links.
+    METRIC_BYTES_AGGR,          //Aggr-core links.
+    METRIC_COUNTERS
+};
+
+/*
+ * Periodic snapshots of the CCDN counters at simulated-time intervals. The counters live
+ * where they are counted (MixRouting, ContentFib, ContentCache, GlobalContentManager); a
+ * snapshot only sums them up, so nothing is paid between snapshots except the byte count of
+ * the links, one addition per packet sent. Each snapshot writes the growth of every counter,
+ * the hit and reject ratios and the link utilization of each layer over the interval.
+ */
+class MetricsRecorder
+{
+
+public:
+
+    //fluid is 0 if the transfers go over TCP.
+    MetricsRecorder(GlobalContentManager *manager, FatTreeHelper *helper, FluidTransferEngine *fluid,
+                    const char *filename, unsigned format, double interval);
+    ~MetricsRecorder();
+
+    //Start counting the link bytes and taking snapshots. A last one is taken when the simulator is destroyed.
+    void Start(unsigned systemid);
+
+private:
+
+    MetricsRecorder(const MetricsRecorder &);
+    MetricsRecorder &operator = (const MetricsRecorder &);
+
+    struct Link
+    {
+        Ptr<Node>   m_node;
+        uint32_t    m_iface;
+        unsigned    m_layer;    //0 host-edge, 1 edge-aggr, 2 aggr-core.
+    };
+
+    static void CountBytes(uint64_t *bytes, Ptr<const Packet> p);
+    void Collect(uint64_t *counters, unsigned &fibentries);
+    void Snapshot();
+    void Take();
+    void Write(double now, const uint64_t *delta, const double *ratio, unsigned pending, unsigned fibentries);
+    void Close();
+
+    GlobalContentManager    *m_manager;
+    FatTreeHelper           *m_helper;
+    FluidTransferEngine     *m_fluid;
+    std::ofstream           m_file;
+    unsigned                m_format;
+    double                  m_interval;
+    EventId                 m_snapshot;
+
+    std::vector<Link>       m_links;
+    uint64_t                m_linkbytes[3];     //Packet bytes sent, by layer.
+    double                  m_capacity[3];      //Bits per second of the links of each layer, both ways.
+    uint64_t                m_last[METRIC_COUNTERS];
+    double                  m_lasttime;
+
+};
+};
+
+
+#endif
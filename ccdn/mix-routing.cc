@@ -34,7 +34,9 @@
 #include "ns3/random-variable.h"
 
 #include "fat-tree-helper.h"
+#include "cmp-header.h"
 #include "mix-routing.h"
+#include "event-profiler.h"
 
 NS_LOG_COMPONENT_DEFINE ("MixRouting");
 
@@ -68,12 +70,20 @@ MixRouting::GetTypeId (void)
 MixRouting::MixRouting ()
 {
   m_content_route = true;
+  m_info = 0;
+  m_fib = 0;
+  m_fibsize = 0;
+  m_cache = 0;
+  m_cachepolicy = 0;
+  m_cachesize = 0;
   NS_LOG_FUNCTION_NOARGS ();
 }
 
 MixRouting::~MixRouting ()
 {
   NS_LOG_FUNCTION_NOARGS ();
+  delete m_fib;
+  delete m_cache;
 }
 
 Ptr<Ipv4Route>
@@ -90,18 +100,7 @@ MixRouting::RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice>
 	sockerr = Socket::ERROR_NOTERROR;
 	int iface = IpHashLookup(header.GetDestination().Get(), header.GetSource().Get());
     //uint32_t iface = Lookup(GetTuple(p, header));
-   	Ptr<NetDevice> dev = m_ipv4->GetNetDevice(iface); // Convert output port to device
-   	Ptr<Channel> channel = dev->GetChannel(); // Channel used by the device
-	uint32_t otherEnd = (channel->GetDevice(0)==dev)?1:0; // Which end of the channel?
-	Ptr<Node> nextHop = channel->GetDevice(otherEnd)->GetNode(); // Node at other end
-   	uint32_t nextIf = channel->GetDevice(otherEnd)->GetIfIndex(); // Iface num at other end
-	Ipv4Address nextHopAddr = nextHop->GetObject<Ipv4>()->GetAddress(nextIf,0).GetLocal(); // Addr of other end
-	Ptr<Ipv4Route> r = Create<Ipv4Route> ();
-	r->SetOutputDevice(m_ipv4->GetNetDevice(iface));
-	r->SetGateway(nextHopAddr);
-	r->SetSource(m_ipv4->GetAddress(iface,0).GetLocal());
-	r->SetDestination(a);
-	return r;
+	return GetInterfaceRoute(iface);
 }
 
 bool
@@ -122,38 +121,23 @@ MixRouting::RouteInput  (Ptr<const Packet> p, const Ipv4Header &header, Ptr<cons
 		return false;
 	};
 
-	// Check if the destination is local
-
-	for (uint32_t j = 0; j < m_ipv4->GetNInterfaces(); j++)
-    {
-        for (uint32_t i = 0; i < m_ipv4->GetNAddresses(j); i++)
-        {
-            Ipv4InterfaceAddress iaddr = m_ipv4->GetAddress (j, i);
-            Ipv4Address addr = iaddr.GetLocal ();
-            if (addr.IsEqual (a))
-            {
-                if (j == iif)
-                {
-                    NS_LOG_LOGIC ("For me (destination " << addr << " match)");
-                }
-                else
-                {
-                    NS_LOG_LOGIC ("For me (destination " << addr << " match) on another interface " << a);
-                }
-                lcb (p, header, iif);
-                return true;
-            }
-        }
-    }
-
-    if (m_node->m_nodetype == 3 && header.GetProtocol() == 0x11U)   //This is an host address, always accept udp cmp packet
-    {
-        NS_LOG_DEBUG ("For me: " << header.GetSource() <<" cmp packet to " << a << ", but I'm " << Ipv4Address(m_node->m_hostaddress));
-        Ipv4Header ip = header;
-        ip.SetDestination(Ipv4Address(m_node->m_hostaddress));
-        lcb (p, ip, iif);
-        return true;
-    }
+	// Check if the destination is local. A host is a leaf, so a cmp packet reaching it has been
+	// steered there by content routing and is taken as its own, whatever host it was sent to.
+	bool cmpAtHost = m_info->m_type == FAT_TREE_HOST && header.GetProtocol() == 0x11U;
+	if (cmpAtHost || IsLocalAddress(a.Get()))
+	{
+		if (cmpAtHost && a.Get() != m_info->m_address)
+		{
+			NS_LOG_DEBUG ("For me: " << header.GetSource() <<" cmp packet to " << a << ", but I'm " << Ipv4Address(m_info->m_address));
+			Ipv4Header ip = header;
+			ip.SetDestination(Ipv4Address(m_info->m_address));
+			lcb (p, ip, iif);
+			return true;
+		}
+		NS_LOG_LOGIC ("For me (destination " << a << " match)");
+		lcb (p, header, iif);
+		return true;
+	}
 
 	// Check if input device supports IP forwarding
 	if (m_ipv4->IsForwarding (iif) == false) {
@@ -166,26 +150,21 @@ MixRouting::RouteInput  (Ptr<const Packet> p, const Ipv4Header &header, Ptr<cons
 	if (header.GetProtocol() == 0x11U && m_content_route)
 	{
 	    outPort = ContentLookup(p, header, idev);
+	    if (outPort == 0)
+	    {
+	        NS_LOG_LOGIC ("Answered from the cache of this switch");
+	        return true;
+	    }
 	}
 	else
 	{
 	    outPort = IpHashLookup(header.GetDestination().Get(), header.GetSource().Get());
 	}
 
+	m_stats.forwarded ++;
 	NS_LOG_LOGIC ("Forwarding to " << outPort);
-   	Ptr<NetDevice> dev = m_ipv4->GetNetDevice(outPort); // Convert output port to device
-   	Ptr<Channel> channel = dev->GetChannel(); // Channel used by the device
-	uint32_t otherEnd = (channel->GetDevice(0)==dev)?1:0; // Which end of the channel?
-	Ptr<Node> nextHop = channel->GetDevice(otherEnd)->GetNode(); // Node at other end
-   	uint32_t nextIf = channel->GetDevice(otherEnd)->GetIfIndex(); // Iface num at other end
-	Ipv4Address nextHopAddr = nextHop->GetObject<Ipv4>()->GetAddress(nextIf,0).GetLocal(); // Addr of other end
-	Ptr<Ipv4Route> r = Create<Ipv4Route> ();
-	r->SetOutputDevice(m_ipv4->GetNetDevice(outPort));
-	r->SetGateway(nextHopAddr);
-	r->SetSource(m_ipv4->GetAddress(outPort,0).GetLocal());
-	r->SetDestination(a);
 	//NS_LOG_LOGIC ("Found unicast destination- calling unicast callback");
-	ucb(r, p, header);
+	ucb(GetInterfaceRoute(outPort), p, header);
 	return true;
 }
 
@@ -204,42 +183,153 @@ MixRouting::SetNode (Ptr<Node> node)
 	NS_ASSERT (m_node == 0 && node != 0);
 	m_node = node;
 	NDevice = m_ipv4->GetNInterfaces()-1;
+	BuildRoutes();
 }
 
+/*
+ * Neighbors in the fat tree never change, so the route out of each interface is made once.
+ * Only the output device, gateway and source are used on forwarding; the destination is
+ * taken from the packet header, so one route object serves every packet.
+ */
 void
+MixRouting::BuildRoutes ()
+{
+	m_routes.assign(m_ipv4->GetNInterfaces(), Ptr<Ipv4Route>());
+	for (uint32_t iface = 1; iface < m_ipv4->GetNInterfaces(); iface++)
+	{
+		Ptr<NetDevice> dev = m_ipv4->GetNetDevice(iface); // Convert output port to device
+		Ptr<Channel> channel = dev->GetChannel(); // Channel used by the device
+		if (channel == 0)
+		{
+			continue;
+		}
+		uint32_t otherEnd = (channel->GetDevice(0)==dev)?1:0; // Which end of the channel?
+		Ptr<Node> nextHop = channel->GetDevice(otherEnd)->GetNode(); // Node at other end
+		uint32_t nextIf = channel->GetDevice(otherEnd)->GetIfIndex(); // Iface num at other end
+		Ipv4Address nextHopAddr = nextHop->GetObject<Ipv4>()->GetAddress(nextIf,0).GetLocal(); // Addr of other end
+		Ptr<Ipv4Route> r = Create<Ipv4Route> ();
+		r->SetOutputDevice(dev);
+		r->SetGateway(nextHopAddr);
+		r->SetSource(m_ipv4->GetAddress(iface,0).GetLocal());
+		m_routes[iface] = r;
+	}
+}
 
-MixRouting::CreateContentFib (int size)
+Ptr<Ipv4Route>
+MixRouting::GetInterfaceRoute (int iface)
+{
+	NS_ASSERT_MSG (iface > 0 && iface < (int)m_routes.size() && m_routes[iface] != 0, "MixRouting: no route out of interface " << iface);
+	return m_routes[iface];
+}
 
+/*
+ * Decode the owner of an address from the scheme of FatTreeHelper::Create: bits 23-17 are
+ * the subtree, bit 16 tells the edge-side links from the core-side ones, and the remaining
+ * fields name the link kind and the switches at both ends. The loopback address is ours too.
+ */
+bool
+MixRouting::IsLocalAddress (uint32_t a)
 {
+	if ((a >> 24) != 10)
+	{
+		return a == 0x7f000001U;
+	}
 
-	m_fib = new ContentFib(m_node->GetNDevices(), size);
+	unsigned subtree = (a >> 17) & 0x7fU;
+	unsigned low = a & 0xffU;
+	if (((a >> 16) & 0x1U) == 0)
+	{
+		unsigned edge = (a >> 10) & 0x3fU;
+		switch ((a >> 8) & 0x3U)
+		{
+			case 0:     //Host (to edge)
+				return m_info->m_type == FAT_TREE_HOST && a == m_info->m_address;
+			case 1:     //Aggr (to edge)
+				return m_info->m_type == FAT_TREE_AGGR && m_info->m_subtree == subtree && m_info->m_id == low;
+			default:    //Edge (to host, to aggr)
+				return m_info->m_type == FAT_TREE_EDGE && m_info->m_subtree == subtree && m_info->m_id == edge;
+		}
+	}
 
+	unsigned middle = (a >> 8) & 0x3fU;
+	switch ((a >> 14) & 0x3U)
+	{
+		case 0:     //Aggr (to core)
+			return m_info->m_type == FAT_TREE_AGGR && m_info->m_subtree == subtree && m_info->m_id == middle;
+		case 1:     //Core (to aggr): the core ID is aggr ID * N + port, and a core has 2N devices.
+			return m_info->m_type == FAT_TREE_CORE && m_info->m_id == low * (NDevice / 2) + middle;
+	}
+	return false;
+}
+
+void
+MixRouting::CreateContentFib (int size, bool lazy)
+{
+	m_fibsize = size;
+	if (!lazy)
+	{
+		GetFib();
+	}
+}
+
+void
+MixRouting::CreateContentCache (unsigned policy, int size, bool lazy)
+{
+	m_cachepolicy = policy;
+	m_cachesize = size;
+	if (!lazy)
+	{
+		GetCache();
+	}
+}
+
+ContentFib *
+MixRouting::GetFib ()
+{
+	if (m_fib == 0)
+	{
+		m_fib = new ContentFib(m_node->GetNDevices(), m_fibsize, m_node->GetId());
+	}
+	return m_fib;
+}
+
+//0 if the node does not cache.
+ContentCache *
+MixRouting::GetCache ()
+{
+	if (m_cache == 0 && m_cachesize > 0)
+	{
+		m_cache = ContentCache::Create(m_cachepolicy, m_cachesize);
+	}
+	return m_cache;
 }
 
 int
 MixRouting::IpHashLookup(uint32_t dst, uint32_t src)
 {
-    if (m_node == 0)
+    ProfileScope profile(PROFILE_IP_HASH_LOOKUP);
+    if (m_node == 0 || m_info == 0)
     {
         NS_LOG_LOGIC("I dunno why, but my node is empty!");
         return 1;
     }
 
-    switch (m_node->m_nodetype)
+    switch (m_info->m_type)
     {
-        case 0:
+        case FAT_TREE_CORE:
             return ((dst>>17)&0x7fU) + 1;
-        case 1: //Aggr
-            if (((dst>>17)&0x7fU) == m_node->m_subtreeid)
+        case FAT_TREE_AGGR:
+            if (((dst>>17)&0x7fU) == m_info->m_subtree)
                 return (dst>>10)%0x40U + 1;
             else
                 return NDevice/2 + 1 + src%0x100U;
-        case 2: //Edge
-            if (((dst>>10)&0x3fbfU) == (m_node->m_subtreeid<<7) + m_node->m_nodeid)
+        case FAT_TREE_EDGE:
+            //Only host addresses are below. The aggregation switches' ones in this subnet go up.
+            if (((dst>>10)&0x3fbfU) == (m_info->m_subtree<<7) + m_info->m_id && (dst&0x300U) == 0)
                 return dst%0x100U + 1;
             else
                 return NDevice/2 + 1 + dst%0x100U;
-        case 3: //Host
+        case FAT_TREE_HOST:
             return 1;
     }
     return -1;
@@ -248,72 +338,94 @@ MixRouting::IpHashLookup(uint32_t dst, uint32_t src)
 int
 MixRouting::ContentLookup(Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev)
 {
-    CmpHeader *cmp_header = new CmpHeader;
-    uint8_t buffer[sizeof(CmpHeader)+8];
-    //p->CopyData((uint8_t*)cmp_header, sizeof(CmpHeader));
-    p->CopyData(buffer, sizeof(CmpHeader)+8);
-    memcpy(cmp_header, buffer+8, sizeof(CmpHeader));
-	uint8_t		p_type = cmp_header->type;
-	uint64_t	p_content = cmp_header->content;
-	uint32_t	p_version = cmp_header->version;
-	delete cmp_header;
+    ProfileScope profile(PROFILE_CONTENT_LOOKUP);
+    CmpHeader cmp_header;
+    if (!CmpHeader::PeekFromUdp(p, cmp_header))
+    {
+        return IpHashLookup(header.GetDestination().Get(), header.GetSource().Get());
+    }
+	uint8_t		p_type = cmp_header.GetType();
+	uint64_t	p_content = cmp_header.GetContent();
+	uint32_t	p_version = cmp_header.GetVersion();
 	int			iintf = m_ipv4->GetInterfaceForDevice(idev);
 	int			fintf = 0;
+	ContentFib	*fib = GetFib();
+	ContentCache	*cache = GetCache();
 
-	NS_LOG_INFO ("Forwarding for cmp packet with content " << p_content << ", version " << p_version << " and type " << p_type << " from " << iintf);
+	NS_LOG_INFO ("Forwarding for cmp packet with content " << p_content << ", version " << p_version << " and type " << (unsigned)p_type << " from " << iintf);
 
 	switch (p_type)
 	{
 	case 0: //Normal
         return IpHashLookup(header.GetDestination().Get(), header.GetSource().Get());
 	case 1: //Request
+		m_stats.requests ++;
+		//A request from below is answered here if the switch has the content.
+		if (cache != 0 && DeviceDown(iintf) && cache->HasCache(p_content, p_version))
+		{
+			m_stats.answered ++;
+			NS_LOG_LOGIC ("Switch cache hit on " << p_content << " for " << header.GetSource());
+			if (!CacheHit.IsNull())
+			{
+				CacheHit(m_node, header.GetSource().Get(), p_content, p_version);
+			}
+			return 0;
+		}
 		//For any incoming request, first delete its ND. They will never be put there.
-		m_fib->RemoveFibND(p_content, p_version, iintf);
+		fib->RemoveFibND(p_content, p_version, iintf);
 
 		fintf = IpHashLookup(header.GetDestination().Get(), header.GetSource().Get());
 		if (DeviceDown(fintf))
 		{
-		    m_fib->InsertFibND(p_content, p_version, fintf);
+		    fib->InsertFibND(p_content, p_version, fintf);
 		}
 
-		fintf = m_fib->GetForwardingND(p_content, p_version);
+		fintf = fib->GetForwardingND(p_content, p_version);
 		if (fintf != -1)
 		{
+			m_stats.fibhits ++;
 			return fintf;
 		}
 		//No hit. so we have to content hash to go upward, or pure ip.
-		if (DeviceDown(iintf) && m_node->m_nodetype != 0)
+		if (DeviceDown(iintf) && m_info->m_type != FAT_TREE_CORE)
 		{
 			return ContentHash(p_content);	//Content hash up
 		}
 		else
 		{
 			fintf = IpHashLookup(header.GetDestination().Get(), header.GetSource().Get());	//Pure ip
-			m_fib->InsertFibND(p_content, p_version, fintf);
+			fib->InsertFibND(p_content, p_version, fintf);
 			return fintf;
 		}
-	case 2: //Reply
 	case 3: //Finish
+		//The content has been delivered past this switch. Keep a copy.
+		if (cache != 0)
+		{
+			cache->AddCache(p_content, p_version);
+		}
+		//Fall through
+	case 2: //Reply
 		//It means 'I'v got what you need'. Better tell everyone about this.
 		if (DeviceDown(iintf))
 		{
-			m_fib->InsertFibND(p_content, p_version, iintf);
-			m_fib->FreshFibEntry(p_content, p_version);
-			if (m_node->m_nodetype != 0)
+			fib->InsertFibND(p_content, p_version, iintf);
+			fib->FreshFibEntry(p_content, p_version);
+			if (m_info->m_type != FAT_TREE_CORE)
 			{
 				return ContentHash(p_content);
 			}
 		}
 		return IpHashLookup(header.GetDestination().Get(), header.GetSource().Get());
 	case 4: //Reject
+		m_stats.rejects ++;
 		//'I aint got it. Don't make the table trick anyone nomore.
 		if (DeviceDown(iintf))
 		{
-			if (m_fib->RemoveFibND(p_content, p_version, iintf) && m_node->m_nodetype != 0)
+			if (fib->RemoveFibND(p_content, p_version, iintf) && m_info->m_type != FAT_TREE_CORE)
 			{
 				return fintf = ContentHash(p_content);
 			}
-			else if (m_node->m_nodetype != 0)
+			else if (m_info->m_type != FAT_TREE_CORE)
 			{
 			    return fintf = FalseContentHash(p_content);
 			}
@@ -326,11 +438,11 @@ MixRouting::ContentLookup(Ptr<const Packet> p, const Ipv4Header &header, Ptr<con
 int
 MixRouting::ContentHash(uint64_t content)
 {
-	if (m_node->m_nodetype == 2)		//Edge
+	if (m_info->m_type == FAT_TREE_EDGE)
 	{
 		return (content % (NDevice/2)) + NDevice/2 + 1;
 	}
-	else if (m_node->m_nodetype == 1)	//Aggr
+	else if (m_info->m_type == FAT_TREE_AGGR)
 	{
 		return ((content/(NDevice/2)) % (NDevice/2)) + NDevice/2 + 1;
 	}
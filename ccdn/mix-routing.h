@@ -22,15 +22,20 @@
 
 #include <list>
 #include <set>
+#include <vector>
 #include <stdint.h>
 #include "ns3/ipv4-address.h"
 #include "ns3/ptr.h"
 #include "ns3/ipv4.h"
 #include "ns3/simulator.h"
 #include "ns3/ipv4-routing-protocol.h"
+#include "ns3/ipv4-route.h"
 #include "ns3/ref-count-base.h"
+#include "ns3/callback.h"
 
 #include "content-fib.h"
+#include "content-cache.h"
+#include "fat-tree-node.h"
 
 namespace ns3 {
 
@@ -43,6 +48,32 @@ class Ipv4RoutingTableEntry;
 class Ipv4MulticastRoutingTableEntry;
 class Node;
 
+//Which switches keep an on-path cache, see Parameter::switch_cache_layers.
+enum SwitchCacheLayer
+{
+	SWITCH_CACHE_EDGE = 0x1,
+	SWITCH_CACHE_AGGR = 0x2
+};
+
+struct RoutingStats
+{
+	uint64_t	forwarded;	//Packets forwarded, by ip or by content.
+	uint64_t	requests;	//Requests routed by content.
+	uint64_t	fibhits;	//Requests sent where the fib points.
+	uint64_t	answered;	//Requests answered from the cache of the switch.
+	uint64_t	rejects;	//Rejects passing by.
+
+	RoutingStats() : forwarded(0), requests(0), fibhits(0), answered(0), rejects(0) {};
+	void Add(const RoutingStats &s)
+	{
+		forwarded += s.forwarded;
+		requests += s.requests;
+		fibhits += s.fibhits;
+		answered += s.answered;
+		rejects += s.rejects;
+	};
+};
+
 // Class for hash-based routing logic
 class MixRouting : public Ipv4RoutingProtocol
 {
@@ -66,24 +97,58 @@ public:
 	virtual void PrintRoutingTable(Ptr<OutputStreamWrapper> wrapper) const {};
 	virtual void SetIpv4 (Ptr<Ipv4> ipv4);
 	virtual void SetNode (Ptr<Node> node);
+	//Where the node is in the tree. Kept by FatTreeHelper; set it before SetNode().
+	void SetNodeInfo (const FatTreeNode *info) {m_info = info;};
 
-	void CreateContentFib (int size);
+	//With lazy set, the fib (or cache) is only made when the first packet needs it.
+	void CreateContentFib (int size, bool lazy = false);
+	//policy is one of CachePolicy.
+	void CreateContentCache (unsigned policy, int size, bool lazy = false);
+	bool HasContentCache () const {return m_cachesize > 0;};
+	//0 if the switch has no cache, or a lazy one has not been made yet.
+	ContentCache *GetContentCache () {return m_cache;};
+	//The function to invoke with (switch, requester address, content, version) when a request
+	//is answered from the cache of this switch. The request itself is not forwarded.
+	void SetCacheHitCallback (Callback<void, Ptr<Node>, uint32_t, uint64_t, uint32_t> hit) {CacheHit = hit;};
 	void DisableContentRoute() {m_content_route = false;};
 
-protected:
+	const RoutingStats &GetStats() const {return m_stats;};
+	//Empty if the node has no fib, or a lazy one has not been made yet.
+	FibStats GetFibStats() const {return m_fib != 0 ? m_fib->GetStats() : FibStats();};
+	unsigned GetFibSize() const {return m_fib != 0 ? m_fib->GetSize() : 0;};
 
     //Decide the nfd by pure ip. If there is multiple available then the result will be hashed from dst and src.
+    //The fluid transfer engine follows the same paths.
     int IpHashLookup(uint32_t dst, uint32_t src);
+
+protected:
+
 	//Decide the nfd by content. This is only for cmp packets.
+	//Return 0 if the packet is answered by this switch and goes no further.
 	int ContentLookup(Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev);
 	int ContentHash(uint64_t content);
 	int FalseContentHash(uint64_t content);
 	bool DeviceDown(int nd);
+	ContentFib *GetFib();
+	ContentCache *GetCache();
+	//Return true if the address is one of this node's.
+	bool IsLocalAddress(uint32_t a);
+	//Make the route out of every interface, and get one of them.
+	void BuildRoutes();
+	Ptr<Ipv4Route> GetInterfaceRoute(int iface);
 
-    Ptr<Node> m_node;   // Hook to the node (you can visit the position of the node)
+    Ptr<Node> m_node;   // Hook to the node
+	const FatTreeNode *m_info;	// Position of the node in the tree
 	Ptr<Ipv4> m_ipv4;	// Hook to the Ipv4 object of this node
 	ContentFib *m_fib;
+	int m_fibsize;
+	ContentCache *m_cache;	// On-path cache of contents, filled by the finish packets passing by
+	unsigned m_cachepolicy;
+	int m_cachesize;	// 0 if the node does not cache
+	Callback<void, Ptr<Node>, uint32_t, uint64_t, uint32_t> CacheHit;
+	std::vector<Ptr<Ipv4Route> > m_routes;	// Route out of each interface, indexed by interface
 	int	NDevice;		// The number of devices (not including local device)
+	RoutingStats m_stats;
 
 	bool m_content_route;
 };
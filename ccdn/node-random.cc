@@ -0,0 +1,15 @@
+#include "ns3/rng-seed-manager.h"
+#include "node-random.h"
+
+namespace ns3
+{
+
+uint64_t
+NodeRandom::GetStreamKey(uint32_t stream)
+{
+    uint64_t key = ContentHashMix(RngSeedManager::GetSeed() + 0x9e3779b97f4a7c15ULL);
+    key = ContentHashMix(key ^ RngSeedManager::GetRun());
+    return ContentHashMix(key ^ ((uint64_t)stream << 32 | 0x5bd1e995));
+}
+
+};
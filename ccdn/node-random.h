@@ -0,0 +1,47 @@
+#ifndef NODE_RANDOM_H
+#define NODE_RANDOM_H
+
+#include <inttypes.h>
+#include "content-index.h"
+
+namespace ns3
+{
+
+/*
+ * The random stream of one node. It is counter based (SplitMix64): the n-th draw is a hash
+ * of the stream key and n, so a node draws the same numbers whatever the other nodes do,
+ * in one process, in forked sweeps or split over MPI ranks. The key comes from the ns-3
+ * seed and run number (RngSeedManager, --RngSeed and --RngRun) and the Node ID.
+ */
+class NodeRandom
+{
+
+public:
+
+    NodeRandom() : m_key(0), m_counter(0) {};
+    explicit NodeRandom(uint32_t stream) : m_key(GetStreamKey(stream)), m_counter(0) {};
+
+    //Start the stream of a node over.
+    void Seed(uint32_t stream) {m_key = GetStreamKey(stream); m_counter = 0;};
+
+    uint64_t Next()
+    {
+        m_counter ++;
+        return ContentHashMix(m_key + m_counter * 0x9e3779b97f4a7c15ULL);
+    };
+    //Uniform in [0, n). n must be above 0.
+    uint32_t Below(uint32_t n) {return (uint32_t)(((Next() >> 32) * n) >> 32);};
+
+    //Key of a stream under the current seed and run number.
+    static uint64_t GetStreamKey(uint32_t stream);
+
+private:
+
+    uint64_t    m_key;
+    uint64_t    m_counter;
+
+};
+};
+
+
+#endif
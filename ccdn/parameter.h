@@ -13,7 +13,22 @@ struct Parameter
     unsigned cache_size;
     unsigned port;
     bool enable_cache;
+    unsigned cache_policy;      //One of CachePolicy in content-cache.h
+    unsigned switch_cache_size; //Capacity of the on-path caches of the switches, 0 for none.
+    unsigned switch_cache_layers;   //SwitchCacheLayer bits in mix-routing.h
     char* filename;
+    unsigned result_format;     //One of ResultFormat in result-sink.h
+    bool lean_topology;         //Make fibs, caches and host sockets when first needed, see FatTreeHelper::Create().
+    bool fluid_transfer;        //Model the data transfers as fluid flows instead of TCP, see fluid-transfer.h
+    //Unanswered requests are sent again, see TaskRecorder::SetTimeout().
+    double task_timeout;        //Seconds before the first retry.
+    double task_backoff;        //Factor applied to the timeout on each retry.
+    double task_max_timeout;    //Cap of the timeout.
+    double metrics_interval;    //Seconds of simulated time between metrics snapshots, 0 for none.
+    unsigned metrics_format;    //One of MetricsFormat in metrics-recorder.h
+    //Distributed simulation. Subtrees are split over the systems, see FatTreeHelper::Create().
+    unsigned systems;           //Number of systems (MPI ranks), 1 if not distributed.
+    unsigned systemid;          //The system this process simulates.
 };
 
 };
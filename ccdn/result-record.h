@@ -0,0 +1,140 @@
+#ifndef RESULT_RECORD_H
+#define RESULT_RECORD_H
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * The binary result format. It has no dependency on ns-3, so tools outside the simulator
+ * can include it as well.
+ *
+ * A file starts with a 16-byte header: the magic "CCDNRES1", then the record size as a
+ * little-endian uint32 and 4 reserved bytes. Records follow back to back, each of them
+ * RESULT_RECORD_SIZE bytes, all fields little-endian:
+ *
+ *   | content 8 | remote 4 | local 4 | start 8 | finish 8 | hops 1 | cached 1 | reserved 2 |
+ *
+ * start and finish are IEEE-754 doubles in seconds.
+ */
+
+namespace ns3 {
+
+struct TaskResult
+{
+    uint64_t    content;
+    uint32_t    remote;
+    uint32_t    local;
+    double      start;
+    double      finish;
+    uint8_t     hops;       //Links between the local and the remote host.
+    uint8_t     cached;     //1 if the remote host served the content from its cache, 2 if a switch
+                            //on the way did. remote is then the Node ID of the switch.
+};
+
+//Running totals over the finished tasks of a run.
+struct ResultSummary
+{
+    uint64_t    tasks;
+    uint64_t    cached;     //Tasks served from a cache.
+    uint64_t    hops;       //Sum of the hops.
+    double      latency;    //Sum of finish - start.
+
+    ResultSummary() : tasks(0), cached(0), hops(0), latency(0) {};
+    void Add(const TaskResult &r)
+    {
+        tasks ++;
+        cached += r.cached ? 1 : 0;
+        hops += r.hops;
+        latency += r.finish - r.start;
+    };
+};
+
+static const char RESULT_MAGIC[8] = {'C', 'C', 'D', 'N', 'R', 'E', 'S', '1'};
+static const unsigned RESULT_HEADER_SIZE = 16;
+static const unsigned RESULT_RECORD_SIZE = 36;
+
+inline void ResultPutU32(uint8_t *buf, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        buf[i] = (v >> (8*i)) & 0xFF;
+    }
+}
+
+inline void ResultPutU64(uint8_t *buf, uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        buf[i] = (v >> (8*i)) & 0xFF;
+    }
+}
+
+inline uint32_t ResultGetU32(const uint8_t *buf)
+{
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--)
+    {
+        v = (v << 8) | buf[i];
+    }
+    return v;
+}
+
+inline uint64_t ResultGetU64(const uint8_t *buf)
+{
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--)
+    {
+        v = (v << 8) | buf[i];
+    }
+    return v;
+}
+
+inline void EncodeResultHeader(uint8_t *buf)
+{
+    memcpy(buf, RESULT_MAGIC, 8);
+    ResultPutU32(buf + 8, RESULT_RECORD_SIZE);
+    ResultPutU32(buf + 12, 0);
+}
+
+//Return the record size, or 0 if this is not a result file.
+inline unsigned DecodeResultHeader(const uint8_t *buf)
+{
+    if (memcmp(buf, RESULT_MAGIC, 8) != 0)
+    {
+        return 0;
+    }
+    return ResultGetU32(buf + 8);
+}
+
+inline void EncodeResult(const TaskResult &r, uint8_t *buf)
+{
+    uint64_t start, finish;
+    memcpy(&start, &r.start, 8);
+    memcpy(&finish, &r.finish, 8);
+    ResultPutU64(buf, r.content);
+    ResultPutU32(buf + 8, r.remote);
+    ResultPutU32(buf + 12, r.local);
+    ResultPutU64(buf + 16, start);
+    ResultPutU64(buf + 24, finish);
+    buf[32] = r.hops;
+    buf[33] = r.cached;
+    buf[34] = 0;
+    buf[35] = 0;
+}
+
+inline void DecodeResult(const uint8_t *buf, TaskResult &r)
+{
+    uint64_t start = ResultGetU64(buf + 16);
+    uint64_t finish = ResultGetU64(buf + 24);
+    r.content = ResultGetU64(buf);
+    r.remote = ResultGetU32(buf + 8);
+    r.local = ResultGetU32(buf + 12);
+    memcpy(&r.start, &start, 8);
+    memcpy(&r.finish, &finish, 8);
+    r.hops = buf[32];
+    r.cached = buf[33];
+}
+
+};
+
+#endif
@@ -0,0 +1,104 @@
+#define __STDC_FORMAT_MACROS 1
+#include <inttypes.h>
+#include <stdio.h>
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+
+#include "result-sink.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE ("ResultSink");
+
+ResultSink*
+ResultSink::Create(const char *filename, unsigned format)
+{
+    switch (format)
+    {
+    case RESULT_TEXT:
+        return new TextResultSink(filename);
+    case RESULT_BINARY:
+        return new BinaryResultSink(filename);
+    }
+    NS_FATAL_ERROR("Unknown result format " << format);
+    return 0;
+}
+
+ResultSink::ResultSink(const char *filename)
+{
+    m_file.open(filename, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!m_file.is_open())
+    {
+        NS_FATAL_ERROR("Cannot open result file " << filename);
+    }
+    m_block = new uint8_t[m_blocksize];
+    m_used = 0;
+}
+
+ResultSink::~ResultSink()
+{
+    Close();
+    delete [] m_block;
+}
+
+uint8_t*
+ResultSink::Reserve(unsigned len)
+{
+    if (m_used + len > m_blocksize)
+    {
+        Flush();
+    }
+    return m_block + m_used;
+}
+
+void
+ResultSink::Flush()
+{
+    if (m_used > 0 && m_file.is_open())
+    {
+        m_file.write((const char*)m_block, m_used);
+        NS_LOG_LOGIC("Flushed " << m_used << " bytes of results");
+    }
+    m_used = 0;
+}
+
+void
+ResultSink::Close()
+{
+    if (!m_file.is_open())
+    {
+        return;
+    }
+    Flush();
+    m_file.close();
+}
+
+
+void
+TextResultSink::Write(const TaskResult &result)
+{
+    //The same text as operator<< gives with the default precision.
+    static const unsigned maxline = 128;
+    char *buf = (char*)Reserve(maxline);
+    int len = snprintf(buf, maxline, "%" PRIu64 " from %u to %u start %g end %g\n",
+                       result.content, result.remote, result.local, result.start, result.finish);
+    Commit(len);
+}
+
+
+BinaryResultSink::BinaryResultSink(const char *filename)
+    : ResultSink(filename)
+{
+    EncodeResultHeader(Reserve(RESULT_HEADER_SIZE));
+    Commit(RESULT_HEADER_SIZE);
+}
+
+void
+BinaryResultSink::Write(const TaskResult &result)
+{
+    EncodeResult(result, Reserve(RESULT_RECORD_SIZE));
+    Commit(RESULT_RECORD_SIZE);
+}
+
+};
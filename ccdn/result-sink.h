@@ -0,0 +1,78 @@
+#ifndef RESULT_SINK_H
+#define RESULT_SINK_H
+
+#include <inttypes.h>
+#include <fstream>
+
+#include "result-record.h"
+
+namespace ns3
+{
+
+enum ResultFormat
+{
+    RESULT_TEXT = 0,        //One line per task: "<content> from <remote> to <local> start <t> end <t>"
+    RESULT_BINARY = 1       //Fixed-width records, see result-record.h
+};
+
+/*
+ * Where the finished tasks go. The output file is opened once and records are collected
+ * in a large in-memory block, which is written out only when it is full or on Close().
+ */
+class ResultSink
+{
+
+public:
+
+    static ResultSink* Create(const char *filename, unsigned format);
+    virtual ~ResultSink();
+
+    virtual void Write(const TaskResult &result) = 0;
+    //Write out whatever is buffered.
+    void Flush();
+    //Flush and close the file. Nothing may be written afterwards.
+    void Close();
+
+protected:
+
+    ResultSink(const char *filename);
+    //Get room for len bytes in the block, flushing it first if needed.
+    uint8_t *Reserve(unsigned len);
+    void Commit(unsigned len) {m_used += len;};
+
+private:
+
+    ResultSink(const ResultSink &);
+    ResultSink &operator = (const ResultSink &);
+
+    std::ofstream   m_file;
+    uint8_t         *m_block;
+    unsigned        m_used;
+
+    static const unsigned m_blocksize = 1 << 20;
+
+};
+
+class TextResultSink : public ResultSink
+{
+
+public:
+
+    TextResultSink(const char *filename) : ResultSink(filename) {};
+    virtual void Write(const TaskResult &result);
+
+};
+
+class BinaryResultSink : public ResultSink
+{
+
+public:
+
+    BinaryResultSink(const char *filename);
+    virtual void Write(const TaskResult &result);
+
+};
+};
+
+
+#endif
@@ -1,9 +1,16 @@
+#define __STDC_LIMIT_MACROS 1
+#include <stdint.h>
+#include <cmath>
 #include "ns3/nstime.h"
+#include "ns3/simulator.h"
 #include "ns3/log.h"
+#include "ns3/assert.h"
 
 #include "global-content-manager.h"
+#include "content-index.h"
 
 #include "task-recorder.h"
+#include "event-profiler.h"
 
 namespace ns3
 {
@@ -12,24 +19,119 @@ NS_LOG_COMPONENT_DEFINE ("TaskRecorder");
 
 NS_OBJECT_ENSURE_REGISTERED (TaskRecorder);
 
-TaskRecorder::TaskRecorder(char* filename)
+TaskRecorder::TaskRecorder(const char* filename, unsigned format)
 {
-    m_filename = filename;
-    m_list = new std::list<Task*>(0);
+    m_sink = ResultSink::Create(filename, format);
+    m_buckets.assign(1024, (Task*)0);
+    m_numtask = 0;
+    m_reviewtick = 0;
+    m_timeout = 0.5;
+    m_backoff = 2;
+    m_maxtimeout = 8;
 
-    std::ofstream file;
-    file.open(filename);
-    //file<<"Simulation result"<<std::endl;
-    file.flush();
-    file.close();
+    Simulator::ScheduleDestroy(&ns3::TaskRecorder::Close, this);
+}
 
-    //Simulator::Schedule(Seconds(0.0), &ns3::TaskRecorder::ReviewTask, this);
+TaskRecorder::~TaskRecorder()
+{
+    delete m_sink;
+}
+
+
+unsigned
+TaskRecorder::Bucket(unsigned local, uint64_t content) const
+{
+    return ContentHashMix(content ^ ((uint64_t)local * 0x9e3779b97f4a7c15ULL)) & (m_buckets.size() - 1);
+}
+
+void
+TaskRecorder::GrowIndex()
+{
+    std::vector<Task*> old;
+    old.swap(m_buckets);
+    m_buckets.assign(old.size() * 2, (Task*)0);
+
+    //Rehash bucket by bucket, keeping tasks of the same key in registering order.
+    std::vector<Task*> tails(m_buckets.size(), (Task*)0);
+    for (unsigned i = 0; i < old.size(); i++)
+    {
+        Task *task = old[i];
+        while (task != 0)
+        {
+            Task *next = task->m_hashnext;
+            unsigned b = Bucket(task->m_local, task->m_content);
+            task->m_hashnext = 0;
+            if (tails[b] == 0)
+            {
+                m_buckets[b] = task;
+            }
+            else
+            {
+                tails[b]->m_hashnext = task;
+            }
+            tails[b] = task;
+            task = next;
+        }
+    }
+}
+
+void
+TaskRecorder::SetTimeout(double timeout, double backoff, double maxtimeout)
+{
+    NS_ASSERT_MSG(timeout > 0 && backoff >= 1, "TaskRecorder: timeout " << timeout << " and backoff " << backoff);
+    m_timeout = timeout;
+    m_backoff = backoff;
+    m_maxtimeout = maxtimeout > timeout ? maxtimeout : timeout;
+}
+
+double
+TaskRecorder::GetTimeout(const Task *task) const
+{
+    double timeout = m_timeout * std::pow(m_backoff, (double)task->m_retries);
+    return timeout < m_maxtimeout ? timeout : m_maxtimeout;
+}
+
+uint64_t
+TaskRecorder::TimeToTick(double time, bool roundup) const
+{
+    //Deadlines are rounded up so a task never reloads before its timeout; the epsilon absorbs
+    //the error of converting a tick to seconds and back.
+    double ticks = time / m_tick;
+    if (roundup)
+    {
+        return (uint64_t)std::ceil(ticks - 1e-6);
+    }
+    return (uint64_t)std::floor(ticks + 1e-6);
+}
+
+void
+TaskRecorder::ScheduleReview()
+{
+    uint64_t next = m_wheel.NextTick();
+    if (next == (uint64_t)-1)
+    {
+        return;
+    }
+
+    if (m_review.IsRunning() && m_reviewtick <= next)
+    {
+        return;
+    }
+    m_review.Cancel();
+    m_reviewtick = next;
+    Time delay = Seconds(next * m_tick) - Simulator::Now();
+    if (delay.IsStrictlyNegative())
+    {
+        delay = Seconds(0);
+    }
+    m_review = Simulator::Schedule(delay, &ns3::TaskRecorder::ReviewTask, this);
 }
 
 
 void
 TaskRecorder::RegisterTask(unsigned local, uint64_t content)
 {
+    ProfileScope profile(PROFILE_TASK_REGISTER);
     Task *task = new Task;
     task->m_local = local;
     task->m_content = content;
@@ -39,14 +141,33 @@ TaskRecorder::RegisterTask(unsigned local, uint64_t content)
 
     task->m_remote = 0;
     task->m_finishtime = 0;
+    task->m_hops = 0;
+    task->m_cached = 0;
+    task->m_retries = 0;
 
-    m_list->push_back(task);
+    if (m_numtask >= m_buckets.size())
+    {
+        GrowIndex();
+    }
+    task->m_hashnext = 0;
+    Task **link = &m_buckets[Bucket(local, content)];
+    while (*link != 0)
+    {
+        link = &(*link)->m_hashnext;
+    }
+    *link = task;
+    m_numtask ++;
+
+    TimerWheel::InitNode(task);
+    m_wheel.Insert(task, TimeToTick(task->m_lastreloadtime + GetTimeout(task), true));
+    ScheduleReview();
 }
 
 
 void
-TaskRecorder::UpdateTask(unsigned local, unsigned remote, uint64_t content)
+TaskRecorder::UpdateTask(unsigned local, unsigned remote, uint64_t content, uint8_t hops, uint8_t cached)
 {
+    ProfileScope profile(PROFILE_TASK_UPDATE);
     Task *task = GetTask(local, content);
     if (task == 0)
     {
@@ -55,11 +176,15 @@ TaskRecorder::UpdateTask(unsigned local, unsigned remote, uint64_t content)
 
     task->m_state = 1;
     task->m_remote = remote;
+    task->m_hops = hops;
+    task->m_cached = cached;
+    m_wheel.Remove(task);
 }
 
 void
 TaskRecorder::FinishTask(unsigned local, uint64_t content)
 {
+    ProfileScope profile(PROFILE_TASK_FINISH);
     Task *task = GetTask(local, content);
     if (task == 0)
     {
@@ -75,9 +200,8 @@ TaskRecorder::FinishTask(unsigned local, uint64_t content)
 Task*
 TaskRecorder::GetTask(unsigned local, uint64_t content)
 {
-    for(std::list<Task*>::iterator iter = m_list->begin(); iter != m_list->end(); iter ++)
+    for (Task *task = m_buckets[Bucket(local, content)]; task != 0; task = task->m_hashnext)
     {
-        Task *task = *iter;
         if (task->m_local == local && task->m_content == content)
         {
             return task;
@@ -89,12 +213,14 @@ TaskRecorder::GetTask(unsigned local, uint64_t content)
 Task*
 TaskRecorder::RemoveTask(unsigned local, uint64_t content)
 {
-    for(std::list<Task*>::iterator iter = m_list->begin(); iter != m_list->end(); iter ++)
+    for (Task **link = &m_buckets[Bucket(local, content)]; *link != 0; link = &(*link)->m_hashnext)
     {
-        Task *task = *iter;
+        Task *task = *link;
         if (task->m_local == local && task->m_content == content)
         {
-            m_list->erase(iter);
+            *link = task->m_hashnext;
+            m_wheel.Remove(task);
+            m_numtask --;
             return task;
         }
     }
@@ -104,30 +230,73 @@ TaskRecorder::RemoveTask(unsigned local, uint64_t content)
 void
 TaskRecorder::WriteTask(Task *task)
 {
-    std::ofstream file;
-    file.open(m_filename, std::ios::app);
-    file<<task->m_content<<" from "<<task->m_remote<<" to "<<task->m_local<<" start "<<task->m_starttime<<" end "<<task->m_finishtime<<std::endl;
-    file.flush();
+    TaskResult result;
+    result.content = task->m_content;
+    result.remote = task->m_remote;
+    result.local = task->m_local;
+    result.start = task->m_starttime;
+    result.finish = task->m_finishtime;
+    result.hops = task->m_hops;
+    result.cached = task->m_cached;
+    m_sink->Write(result);
+    m_summary.Add(result);
     NS_LOG_LOGIC("Task finished and written");
-    file.close();
+}
+
+void
+TaskRecorder::Close()
+{
+    m_sink->Close();
 }
 
 void
 TaskRecorder::ReviewTask()
 {
-    for(std::list<Task*>::iterator iter = m_list->begin(); iter != m_list->end(); iter ++)
+    ProfileScope profile(PROFILE_TASK_REVIEW);
+    double now = Simulator::Now().GetSeconds();
+    std::vector<TimerWheelNode*> expired;
+    m_wheel.Advance(TimeToTick(now, false), expired);
+
+    for (std::vector<TimerWheelNode*>::iterator iter = expired.begin(); iter != expired.end(); iter ++)
     {
-        Task *task = *iter;
+        Task *task = static_cast<Task*>(*iter);
         if (task->m_state == 0)
         {
-            double now = Simulator::Now().GetSeconds();
-            if (now >= task->m_lastreloadtime + m_timeout)
+            NS_LOG_LOGIC("Task of "<<task->m_content<<" on "<<task->m_local<<" timed out, reload it");
+            if (task->m_retries < UINT8_MAX)
             {
-                task->m_lastreloadtime = now;
-                ReloadRequire(task->m_local, task->m_content);
+                task->m_retries ++;
             }
+            Reload(task, now);
         }
     }
+
+    ScheduleReview();
+}
+
+void
+TaskRecorder::RetryTask(unsigned local, uint64_t content)
+{
+    //A reject answers the request, so it is no loss: the backoff stays where it is.
+    Task *task = GetTask(local, content);
+    if (task == 0 || task->m_state != 0)
+    {
+        return;
+    }
+    NS_LOG_LOGIC("Task of "<<content<<" on "<<local<<" rejected, reload it");
+    Reload(task, Simulator::Now().GetSeconds());
+    ScheduleReview();
+}
+
+void
+TaskRecorder::Reload(Task *task, double now)
+{
+    task->m_lastreloadtime = now;
+    m_wheel.Insert(task, TimeToTick(now + GetTimeout(task), true));
+    if (!ReloadRequire.IsNull())
+    {
+        ReloadRequire(task->m_local, task->m_content);
+    }
 }
 
 };
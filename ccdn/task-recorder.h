@@ -2,16 +2,18 @@
 #define TASK_RECORDER_H
 
 #include <inttypes.h>
-#include <list>
-#include <fstream>
+#include <vector>
 #include "ns3/object-factory.h"
+#include "ns3/callback.h"
+#include "ns3/event-id.h"
 
-#include "global-content-manager.h"
+#include "timer-wheel.h"
+#include "result-sink.h"
 
 namespace ns3
 {
 
-struct Task
+struct Task : public TimerWheelNode
 {
     unsigned m_local;
     unsigned m_remote;
@@ -20,6 +22,10 @@ struct Task
     double m_lastreloadtime;
     double m_starttime;
     double m_finishtime;
+    uint8_t m_hops;         //Links between the local and the remote host.
+    uint8_t m_cached;       //Where the content was cached, see TaskResult::cached.
+    uint8_t m_retries;      //Timeouts so far; each one multiplies the next timeout by the backoff.
+    Task *m_hashnext;       //Next task in the same bucket of the task index.
 };
 
 class TaskRecorder : public Object
@@ -28,32 +34,64 @@ class TaskRecorder : public Object
 public:
 
     static TypeId GetTypeId (void) {return TypeId ("ns3::TaskRecorder");};
-    TaskRecorder(char* filename);
-    ~TaskRecorder() {};
+    //format is one of ResultFormat.
+    TaskRecorder(const char* filename, unsigned format);
+    ~TaskRecorder();
 
+    //The function to invoke when a task is not responced in time.
+    void SetReloadCallback(Callback<void, unsigned, uint64_t> reload) {ReloadRequire = reload;};
+    //An unhandled task is reloaded after timeout seconds, then after timeout * backoff^n for its
+    //n-th retry, but never waits longer than maxtimeout.
+    void SetTimeout(double timeout, double backoff, double maxtimeout);
 
     // Start up a new task, add it into the list and set is as unhandled.
     void RegisterTask(unsigned local, uint64_t content);
     // You'll do this when you received an reply. It means you task will begin in no time.
-    void UpdateTask(unsigned local, unsigned remote, uint64_t content);
+    void UpdateTask(unsigned local, unsigned remote, uint64_t content, uint8_t hops, uint8_t cached);
     // You'll do this when you received an finish. The task will be removed after then.
     void FinishTask(unsigned local, uint64_t content);
-    // Get the task. If none, return 0.
+    // Get the task. If none, return 0. If there are several, the earliest registered one is returned.
     Task* GetTask(unsigned local, uint64_t content);
     Task* RemoveTask(unsigned local, uint64_t content);
     void WriteTask(Task *task);
+    // Write out the buffered results and close the output. Called when the simulator is destroyed.
+    void Close();
 
-    // Review all tasks in the list. For each task, if the task is not responced for a long time, then you may reactivate it.
+    // Totals of the tasks written so far, and the number of tasks not finished yet.
+    const ResultSummary &GetSummary() const {return m_summary;};
+    unsigned GetPendingTasks() const {return m_numtask;};
+
+    // Reactivate every unhandled task whose timeout has come. Only the expiring tasks are visited.
     void ReviewTask();
+    // The request of the task was rejected. Reload it now, and count its timeout from now.
+    void RetryTask(unsigned local, uint64_t content);
 
 
 private:
 
-	std::list<Task*> *m_list;
-	void (*ReloadRequire)(unsigned, uint64_t);
-	char* m_filename;
-
-	static const double m_timeout = 0.5;
+    unsigned Bucket(unsigned local, uint64_t content) const;
+    void GrowIndex();
+    uint64_t TimeToTick(double time, bool roundup) const;
+    void ScheduleReview();
+    double GetTimeout(const Task *task) const;
+    void Reload(Task *task, double now);
+
+	//Tasks indexed by (local, content); chained through Task::m_hashnext.
+	std::vector<Task*> m_buckets;
+	unsigned m_numtask;
+	//Reload deadlines of the unhandled tasks.
+	TimerWheel m_wheel;
+	EventId m_review;
+	uint64_t m_reviewtick;
+	Callback<void, unsigned, uint64_t> ReloadRequire;
+	ResultSink *m_sink;
+	ResultSummary m_summary;
+
+	double m_timeout;
+	double m_backoff;
+	double m_maxtimeout;
+
+	static const double m_tick = 0.01;
 };
 };
 
@@ -0,0 +1,178 @@
+#include <inttypes.h>
+#include <vector>
+
+#include "timer-wheel.h"
+
+namespace ns3
+{
+
+//Return the smallest d in [1, 63] such that bit (from + d) % 64 of the mask is set, or 64 if there is none.
+static inline int
+NextOccupied(uint64_t mask, int from)
+{
+    int shift = (from + 1) & 63;
+    uint64_t rotated = shift == 0 ? mask : ((mask >> shift) | (mask << (64 - shift)));
+    //Bit 63 of the rotated mask is 'from' itself, which is not a candidate.
+    rotated &= ~((uint64_t)1 << 63);
+    if (rotated == 0)
+    {
+        return 64;
+    }
+    return __builtin_ctzll(rotated) + 1;
+}
+
+TimerWheel::TimerWheel()
+{
+    m_now = 0;
+    m_size = 0;
+    for (int l = 0; l < m_levels; l++)
+    {
+        m_occupied[l] = 0;
+        for (int s = 0; s < m_slots; s++)
+        {
+            m_heads[l][s].m_wheelprev = &m_heads[l][s];
+            m_heads[l][s].m_wheelnext = &m_heads[l][s];
+        }
+    }
+}
+
+void
+TimerWheel::Place(TimerWheelNode *node)
+{
+    uint64_t tick = node->m_wheeltick;
+    int level = 0;
+    int slot = 0;
+    for (level = 0; level < m_levels; level++)
+    {
+        int shift = level * m_bits;
+        if ((tick >> shift) - (m_now >> shift) < (uint64_t)m_slots)
+        {
+            slot = (tick >> shift) & (m_slots - 1);
+            break;
+        }
+    }
+    if (level == m_levels)
+    {
+        //Too far away: park it in the last slot of the top level, it will be placed again when cascaded.
+        level = m_levels - 1;
+        slot = ((m_now >> (level * m_bits)) + m_slots - 1) & (m_slots - 1);
+    }
+
+    TimerWheelNode *head = &m_heads[level][slot];
+    node->m_wheelprev = head->m_wheelprev;
+    node->m_wheelnext = head;
+    head->m_wheelprev->m_wheelnext = node;
+    head->m_wheelprev = node;
+    node->m_wheellevel = level;
+    node->m_wheelslot = slot;
+    m_occupied[level] |= (uint64_t)1 << slot;
+}
+
+void
+TimerWheel::Insert(TimerWheelNode *node, uint64_t tick)
+{
+    Remove(node);
+    node->m_wheeltick = tick > m_now ? tick : m_now + 1;
+    Place(node);
+    m_size ++;
+}
+
+void
+TimerWheel::Remove(TimerWheelNode *node)
+{
+    if (node->m_wheellevel < 0)
+    {
+        return;
+    }
+
+    node->m_wheelprev->m_wheelnext = node->m_wheelnext;
+    node->m_wheelnext->m_wheelprev = node->m_wheelprev;
+    TimerWheelNode *head = &m_heads[node->m_wheellevel][node->m_wheelslot];
+    if (head->m_wheelnext == head)
+    {
+        m_occupied[node->m_wheellevel] &= ~((uint64_t)1 << node->m_wheelslot);
+    }
+    node->m_wheellevel = -1;
+    node->m_wheelprev = node->m_wheelnext = 0;
+    m_size --;
+}
+
+void
+TimerWheel::Cascade(int level)
+{
+    int slot = (m_now >> (level * m_bits)) & (m_slots - 1);
+    TimerWheelNode *head = &m_heads[level][slot];
+    TimerWheelNode *node = head->m_wheelnext;
+    head->m_wheelprev = head->m_wheelnext = head;
+    m_occupied[level] &= ~((uint64_t)1 << slot);
+
+    while (node != head)
+    {
+        TimerWheelNode *next = node->m_wheelnext;
+        Place(node);
+        node = next;
+    }
+}
+
+uint64_t
+TimerWheel::NextTick() const
+{
+    uint64_t next = (uint64_t)-1;
+    for (int l = 0; l < m_levels; l++)
+    {
+        if (m_occupied[l] == 0)
+        {
+            continue;
+        }
+        int shift = l * m_bits;
+        int d = NextOccupied(m_occupied[l], (m_now >> shift) & (m_slots - 1));
+        if (d == 64)
+        {
+            continue;
+        }
+        uint64_t tick = ((m_now >> shift) + d) << shift;
+        if (tick < next)
+        {
+            next = tick;
+        }
+    }
+    return next;
+}
+
+void
+TimerWheel::Advance(uint64_t tick, std::vector<TimerWheelNode*> &expired)
+{
+    while (m_size > 0)
+    {
+        uint64_t next = NextTick();
+        if (next > tick)
+        {
+            break;
+        }
+        m_now = next;
+
+        //Bring down every level whose slot boundary is crossed right now, highest first.
+        for (int l = m_levels - 1; l > 0; l--)
+        {
+            if ((m_now & (((uint64_t)1 << (l * m_bits)) - 1)) == 0)
+            {
+                Cascade(l);
+            }
+        }
+
+        int slot = m_now & (m_slots - 1);
+        TimerWheelNode *head = &m_heads[0][slot];
+        while (head->m_wheelnext != head)
+        {
+            TimerWheelNode *node = head->m_wheelnext;
+            Remove(node);
+            expired.push_back(node);
+        }
+    }
+    if (tick > m_now)
+    {
+        m_now = tick;
+    }
+}
+
+};
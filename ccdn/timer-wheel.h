@@ -0,0 +1,68 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <inttypes.h>
+#include <vector>
+
+namespace ns3
+{
+
+//Embed this into whatever is put on the wheel.
+struct TimerWheelNode
+{
+    TimerWheelNode  *m_wheelprev;
+    TimerWheelNode  *m_wheelnext;
+    uint64_t        m_wheeltick;    //The tick the timer expires at.
+    int16_t         m_wheellevel;   //-1 if the node is not on the wheel.
+    int16_t         m_wheelslot;
+};
+
+/*
+ * Hierarchical timing wheel counted in integer ticks. Level l has m_slots slots of
+ * m_slots^l ticks each; far timers are cascaded down as time reaches them. Inserting and
+ * removing a timer is O(1), and advancing costs only the slots that actually hold timers,
+ * because empty stretches of time are skipped by looking at the per-level occupancy masks.
+ */
+class TimerWheel
+{
+
+public:
+
+    TimerWheel();
+    ~TimerWheel() {};
+
+    //Put the node on the wheel. A tick not later than the current one expires on the next advance.
+    void Insert(TimerWheelNode *node, uint64_t tick);
+    //Take the node off the wheel. Nothing happens if it is not there.
+    void Remove(TimerWheelNode *node);
+    //Move the time to the tick, and append every expired node to the list in expiring order.
+    void Advance(uint64_t tick, std::vector<TimerWheelNode*> &expired);
+    //Return the next tick at which Advance may have something to do, or -1 if the wheel is empty.
+    uint64_t NextTick() const;
+
+    uint64_t GetTick() const {return m_now;};
+    unsigned GetSize() const {return m_size;};
+    bool IsEmpty() const {return m_size == 0;};
+
+    static void InitNode(TimerWheelNode *node) {node->m_wheellevel = -1; node->m_wheelprev = node->m_wheelnext = 0;};
+
+
+private:
+
+    static const int m_bits = 6;
+    static const int m_slots = 1 << m_bits;
+    static const int m_levels = 4;
+
+    void Place(TimerWheelNode *node);
+    void Cascade(int level);
+
+    TimerWheelNode  m_heads[m_levels][m_slots];    //Circular lists with sentinel heads.
+    uint64_t        m_occupied[m_levels];          //Bit s is set if slot s of the level is not empty.
+    uint64_t        m_now;
+    unsigned        m_size;
+
+};
+};
+
+
+#endif
@@ -0,0 +1,263 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "trace-format.h"
+
+namespace ns3
+{
+
+TraceTextScanner::TraceTextScanner()
+{
+    m_file = 0;
+    m_buf = new char[m_bufsize];
+    m_pos = 0;
+    m_len = 0;
+    m_failed = false;
+    m_line = 0;
+}
+
+TraceTextScanner::~TraceTextScanner()
+{
+    Close();
+    delete [] m_buf;
+}
+
+bool
+TraceTextScanner::Open(const char *filename)
+{
+    Close();
+    m_file = fopen(filename, "rb");
+    Rewind();
+    return m_file != 0;
+}
+
+void
+TraceTextScanner::Close()
+{
+    if (m_file != 0)
+    {
+        fclose(m_file);
+        m_file = 0;
+    }
+}
+
+void
+TraceTextScanner::Rewind()
+{
+    if (m_file != 0)
+    {
+        fseek(m_file, 0, SEEK_SET);
+    }
+    m_pos = 0;
+    m_len = 0;
+    m_failed = false;
+    m_line = 0;
+}
+
+bool
+TraceTextScanner::Refill()
+{
+    if (m_file == 0)
+    {
+        return false;
+    }
+    m_pos = 0;
+    m_len = fread(m_buf, 1, m_bufsize, m_file);
+    return m_len > 0;
+}
+
+int
+TraceTextScanner::SkipSpace()
+{
+    int c = Peek();
+    while (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+    {
+        m_pos ++;
+        c = Peek();
+    }
+    return c;
+}
+
+bool
+TraceTextScanner::ReadUnsigned(unsigned &value)
+{
+    int c = SkipSpace();
+    if (c < '0' || c > '9')
+    {
+        return false;
+    }
+    value = 0;
+    while (c >= '0' && c <= '9')
+    {
+        value = value * 10 + (c - '0');
+        m_pos ++;
+        c = Peek();
+    }
+    return true;
+}
+
+bool
+TraceTextScanner::ReadHex(uint64_t &value)
+{
+    int c = SkipSpace();
+    int digits = 0;
+    value = 0;
+    for (;;)
+    {
+        int d;
+        if (c >= '0' && c <= '9')
+        {
+            d = c - '0';
+        }
+        else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+        {
+            d = (c | 0x20) - 'a' + 10;
+        }
+        else
+        {
+            break;
+        }
+        value = (value << 4) | d;
+        digits ++;
+        m_pos ++;
+        c = Peek();
+    }
+    return digits > 0 && digits <= 16;
+}
+
+bool
+TraceTextScanner::ReadDouble(double &value)
+{
+    //Collect the token and let strtod do the rounding right.
+    char token[64];
+    unsigned len = 0;
+    int c = SkipSpace();
+    while (c != -1 && c != ' ' && c != '\t' && c != '\r' && c != '\n' && len < sizeof(token) - 1)
+    {
+        token[len ++] = c;
+        m_pos ++;
+        c = Peek();
+    }
+    token[len] = 0;
+    char *end;
+    value = strtod(token, &end);
+    return len > 0 && *end == 0;
+}
+
+bool
+TraceTextScanner::Next(TraceRecord &record, std::vector<unsigned> &hosts)
+{
+    hosts.clear();
+    if (m_failed)
+    {
+        return false;
+    }
+
+    int c = SkipSpace();
+    if (c == -1)
+    {
+        return false;
+    }
+    m_line ++;
+    record.m_op = Get();
+    record.m_host = 0;
+
+    bool ok = ReadDouble(record.m_time) && ReadHex(record.m_content);
+    if (ok && record.m_op == 'c')
+    {
+        ok = ReadUnsigned(record.m_host);
+        hosts.resize(ok ? record.m_host : 0);
+        for (unsigned i = 0; ok && i < record.m_host; i++)
+        {
+            ok = ReadUnsigned(hosts[i]);
+        }
+    }
+    else if (ok && record.m_op == 'a')
+    {
+        ok = ReadUnsigned(record.m_host);
+    }
+    else if (ok && record.m_op != 'u')
+    {
+        ok = false;
+    }
+
+    m_failed = !ok;
+    return ok;
+}
+
+
+int64_t
+ConvertTextTrace(const char *input, const char *output)
+{
+    TraceTextScanner scanner;
+    if (!scanner.Open(input))
+    {
+        return -1;
+    }
+    FILE *out = fopen(output, "wb");
+    if (out == 0)
+    {
+        return -1;
+    }
+    static char outbuf[1 << 20];
+    setvbuf(out, outbuf, _IOFBF, sizeof(outbuf));
+
+    BinaryTraceHeader header;
+    memcpy(header.magic, TRACE_MAGIC, 8);
+    header.byteorder = TRACE_BYTEORDER;
+    header.flags = TRACE_FLAG_SORTED;
+    header.records = 0;
+    fwrite(&header, sizeof(header), 1, out);
+
+    TraceRecord record;
+    std::vector<unsigned> hosts;
+    double last = 0;
+    while (scanner.Next(record, hosts))
+    {
+        BinaryTraceRecord r;
+        memset(&r, 0, sizeof(r));
+        r.time = record.m_time;
+        r.content = record.m_content;
+        r.host = record.m_host;
+        r.op = record.m_op;
+        fwrite(&r, sizeof(r), 1, out);
+        if (record.m_op == 'c')
+        {
+            for (unsigned i = 0; i < hosts.size(); i++)
+            {
+                uint32_t h = hosts[i];
+                fwrite(&h, sizeof(h), 1, out);
+            }
+            if (hosts.size() % 2 == 1)
+            {
+                uint32_t pad = 0;
+                fwrite(&pad, sizeof(pad), 1, out);
+            }
+        }
+
+        if (record.m_time < last)
+        {
+            header.flags &= ~TRACE_FLAG_SORTED;
+        }
+        last = record.m_time;
+        header.records ++;
+    }
+
+    bool failed = scanner.Failed();
+    fseek(out, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, out);
+    if (fclose(out) != 0 || failed)
+    {
+        if (failed)
+        {
+            fprintf(stderr, "%s:%llu: malformed trace record\n", input, (unsigned long long)scanner.GetLine());
+        }
+        return -1;
+    }
+    return header.records;
+}
+
+};
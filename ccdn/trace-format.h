@@ -0,0 +1,116 @@
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+/*
+ * Trace records and the two file formats they are stored in. Nothing here depends on
+ * ns-3, so the converter in tools/ builds from this file alone.
+ *
+ * Text format, one record per line:
+ *   c <time> <content> <numHost> <host> ...   Create content on the hosts.
+ *   u <time> <content>                        Update content to the next version.
+ *   a <time> <content> <host>                 Access content from the host.
+ * The content is written as 16 hex digits.
+ *
+ * Binary format, in host byte order and meant to be memory-mapped:
+ *   header  | magic "CCDNTRC1" 8 | byte order 0x01020304 4 | flags 4 | records 8 |
+ *   record  | time 8 | content 8 | host 4 | op 1 | reserved 3 |
+ * host is the accessing host of an 'a' record or the number of hosts of a 'c' record;
+ * a 'c' record is followed by its hosts as uint32, padded with zeros to a multiple of 8
+ * bytes so that every record stays aligned.
+ */
+
+namespace ns3
+{
+
+struct TraceRecord
+{
+    char        m_op;           //'c', 'u' or 'a'
+    double      m_time;
+    uint64_t    m_content;
+    unsigned    m_host;         //The accessing host of 'a', or the number of hosts of 'c'.
+};
+
+struct BinaryTraceHeader
+{
+    char        magic[8];
+    uint32_t    byteorder;
+    uint32_t    flags;
+    uint64_t    records;
+};
+
+struct BinaryTraceRecord
+{
+    double      time;
+    uint64_t    content;
+    uint32_t    host;
+    uint8_t     op;
+    uint8_t     reserved[3];
+};
+
+static const char TRACE_MAGIC[8] = {'C', 'C', 'D', 'N', 'T', 'R', 'C', '1'};
+static const uint32_t TRACE_BYTEORDER = 0x01020304;
+static const uint32_t TRACE_FLAG_SORTED = 0x1;      //Record times never go back.
+
+//The size of a record with its hosts, padding included.
+inline size_t BinaryTraceRecordSize(const BinaryTraceRecord *record)
+{
+    size_t hosts = (record->op == 'c') ? record->host : 0;
+    return sizeof(BinaryTraceRecord) + ((hosts + 1) / 2) * 8;
+}
+
+/*
+ * Reads the text format with large fread()s and hand-written token parsers; no iostream
+ * is involved. Malformed lines stop the scan and set Failed().
+ */
+class TraceTextScanner
+{
+
+public:
+
+    TraceTextScanner();
+    ~TraceTextScanner();
+
+    bool Open(const char *filename);
+    void Close();
+    void Rewind();
+    //Return false at the end of the file or on a malformed line.
+    bool Next(TraceRecord &record, std::vector<unsigned> &hosts);
+    bool Failed() const {return m_failed;};
+    //The line number of the last record read, for error messages.
+    uint64_t GetLine() const {return m_line;};
+
+private:
+
+    TraceTextScanner(const TraceTextScanner &);
+    TraceTextScanner &operator = (const TraceTextScanner &);
+
+    bool Refill();
+    int Peek() {return (m_pos < m_len || Refill()) ? (unsigned char)m_buf[m_pos] : -1;};
+    int Get() {return (m_pos < m_len || Refill()) ? (unsigned char)m_buf[m_pos++] : -1;};
+    //Skip blanks; return the next character without taking it, or -1.
+    int SkipSpace();
+    bool ReadUnsigned(unsigned &value);
+    bool ReadHex(uint64_t &value);
+    bool ReadDouble(double &value);
+
+    FILE        *m_file;
+    char        *m_buf;
+    size_t      m_pos;
+    size_t      m_len;
+    bool        m_failed;
+    uint64_t    m_line;
+
+    static const size_t m_bufsize = 1 << 20;
+
+};
+
+//Convert a text trace into a binary one. Return the number of records, or -1 on error.
+int64_t ConvertTextTrace(const char *input, const char *output);
+
+};
+
+#endif
@@ -0,0 +1,217 @@
+#include <inttypes.h>
+#include <string.h>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+
+#include "trace-reader.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE ("TraceReader");
+
+TraceReader*
+TraceReader::Open(const char *filename)
+{
+    if (BinaryTraceReader::IsBinaryTrace(filename))
+    {
+        return new BinaryTraceReader(filename);
+    }
+    return new TextTraceReader(filename);
+}
+
+bool
+TraceReader::IsSorted()
+{
+    TraceRecord record;
+    const unsigned *hosts;
+    double last = 0;
+    bool sorted = true;
+    Rewind();
+    while (Next(record, hosts))
+    {
+        if (record.m_time < last)
+        {
+            NS_LOG_LOGIC("Trace goes back from "<<last<<" to "<<record.m_time);
+            sorted = false;
+            break;
+        }
+        last = record.m_time;
+    }
+    Rewind();
+    return sorted;
+}
+
+
+TextTraceReader::TextTraceReader(const char *filename)
+{
+    if (!m_scanner.Open(filename))
+    {
+        NS_FATAL_ERROR("Cannot open trace " << filename);
+    }
+}
+
+bool
+TextTraceReader::Next(TraceRecord &record, const unsigned *&hosts)
+{
+    if (!m_scanner.Next(record, m_hosts))
+    {
+        if (m_scanner.Failed())
+        {
+            NS_FATAL_ERROR("Malformed trace record on line " << m_scanner.GetLine());
+        }
+        return false;
+    }
+    hosts = m_hosts.empty() ? 0 : &m_hosts[0];
+    return true;
+}
+
+void
+TextTraceReader::Rewind()
+{
+    m_scanner.Rewind();
+}
+
+
+bool
+BinaryTraceReader::IsBinaryTrace(const char *filename)
+{
+    char magic[8];
+    FILE *file = fopen(filename, "rb");
+    if (file == 0)
+    {
+        return false;
+    }
+    bool binary = fread(magic, 1, 8, file) == 8 && memcmp(magic, TRACE_MAGIC, 8) == 0;
+    fclose(file);
+    return binary;
+}
+
+BinaryTraceReader::BinaryTraceReader(const char *filename)
+{
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        NS_FATAL_ERROR("Cannot open trace " << filename);
+    }
+    m_size = st.st_size;
+    if (m_size < sizeof(BinaryTraceHeader))
+    {
+        NS_FATAL_ERROR("Trace " << filename << " is truncated");
+    }
+    void *map = mmap(0, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        NS_FATAL_ERROR("Cannot map trace " << filename);
+    }
+    madvise(map, m_size, MADV_SEQUENTIAL);
+    m_map = (const uint8_t*)map;
+
+    const BinaryTraceHeader *header = (const BinaryTraceHeader*)m_map;
+    if (memcmp(header->magic, TRACE_MAGIC, 8) != 0 || header->byteorder != TRACE_BYTEORDER)
+    {
+        NS_FATAL_ERROR("Trace " << filename << " is not a binary trace of this machine's byte order");
+    }
+    m_records = header->records;
+    m_flags = header->flags;
+    NS_LOG_INFO("Mapped " << m_records << " trace records from " << filename);
+    Rewind();
+}
+
+BinaryTraceReader::~BinaryTraceReader()
+{
+    munmap((void*)m_map, m_size);
+}
+
+bool
+BinaryTraceReader::Next(TraceRecord &record, const unsigned *&hosts)
+{
+    if (m_pos + sizeof(BinaryTraceRecord) > m_size)
+    {
+        return false;
+    }
+    const BinaryTraceRecord *r = (const BinaryTraceRecord*)(m_map + m_pos);
+    size_t size = BinaryTraceRecordSize(r);
+    if (m_pos + size > m_size)
+    {
+        NS_FATAL_ERROR("Binary trace is truncated");
+    }
+
+    record.m_op = r->op;
+    record.m_time = r->time;
+    record.m_content = r->content;
+    record.m_host = r->host;
+    hosts = (r->op == 'c') ? (const unsigned*)(r + 1) : 0;
+    m_pos += size;
+    return true;
+}
+
+void
+BinaryTraceReader::Rewind()
+{
+    m_pos = sizeof(BinaryTraceHeader);
+}
+
+bool
+BinaryTraceReader::IsSorted()
+{
+    return (m_flags & TRACE_FLAG_SORTED) != 0;
+}
+
+
+MemoryTraceReader::MemoryTraceReader(TraceReader *source)
+{
+    TraceRecord record;
+    const unsigned *hosts;
+    double last = 0;
+    m_sorted = true;
+    source->Rewind();
+    while (source->Next(record, hosts))
+    {
+        if (record.m_time < last)
+        {
+            m_sorted = false;
+        }
+        last = record.m_time;
+        m_records.push_back(record);
+        if (record.m_op == 'c')
+        {
+            m_hosts.insert(m_hosts.end(), hosts, hosts + record.m_host);
+        }
+    }
+    NS_LOG_INFO("Loaded " << m_records.size() << " trace records into memory");
+    Rewind();
+}
+
+bool
+MemoryTraceReader::Next(TraceRecord &record, const unsigned *&hosts)
+{
+    if (m_pos == m_records.size())
+    {
+        return false;
+    }
+    record = m_records[m_pos++];
+    hosts = 0;
+    if (record.m_op == 'c' && record.m_host > 0)
+    {
+        hosts = &m_hosts[m_hostpos];
+        m_hostpos += record.m_host;
+    }
+    return true;
+}
+
+void
+MemoryTraceReader::Rewind()
+{
+    m_pos = 0;
+    m_hostpos = 0;
+}
+
+};
@@ -0,0 +1,102 @@
+#ifndef TRACE_READER_H
+#define TRACE_READER_H
+
+#include <inttypes.h>
+#include <vector>
+
+#include "trace-format.h"
+
+namespace ns3
+{
+
+class TraceReader
+{
+
+public:
+
+    //Open the trace with the reader fitting its format.
+    static TraceReader* Open(const char *filename);
+
+    virtual ~TraceReader() {};
+    //Read the next record. hosts points to the hosts of a 'c' record, and stays valid until the next call.
+    //Return false at the end of the trace.
+    virtual bool Next(TraceRecord &record, const unsigned *&hosts) = 0;
+    //Go back to the first record.
+    virtual void Rewind() = 0;
+
+    //Check that the times never go back. The reader is rewound before and afterwards.
+    virtual bool IsSorted();
+
+};
+
+class TextTraceReader : public TraceReader
+{
+
+public:
+
+    TextTraceReader(const char *filename);
+    virtual ~TextTraceReader() {};
+    virtual bool Next(TraceRecord &record, const unsigned *&hosts);
+    virtual void Rewind();
+
+private:
+
+    TraceTextScanner        m_scanner;
+    std::vector<unsigned>   m_hosts;
+
+};
+
+//Replays a binary trace straight from a read-only mapping of the file.
+class BinaryTraceReader : public TraceReader
+{
+
+public:
+
+    BinaryTraceReader(const char *filename);
+    virtual ~BinaryTraceReader();
+    virtual bool Next(TraceRecord &record, const unsigned *&hosts);
+    virtual void Rewind();
+    //The converter already knows, so the file is not scanned again.
+    virtual bool IsSorted();
+
+    static bool IsBinaryTrace(const char *filename);
+
+private:
+
+    const uint8_t   *m_map;
+    size_t          m_size;
+    size_t          m_pos;
+    uint64_t        m_records;
+    uint32_t        m_flags;
+
+};
+
+//Holds a whole trace in memory, so that it is parsed once and replayed many times.
+//Processes forked afterwards share it copy-on-write.
+class MemoryTraceReader : public TraceReader
+{
+
+public:
+
+    //Read the source to its end. The source can be deleted afterwards.
+    MemoryTraceReader(TraceReader *source);
+    virtual ~MemoryTraceReader() {};
+    virtual bool Next(TraceRecord &record, const unsigned *&hosts);
+    virtual void Rewind();
+    virtual bool IsSorted() {return m_sorted;};
+
+    unsigned GetSize() const {return m_records.size();};
+
+private:
+
+    std::vector<TraceRecord>    m_records;
+    std::vector<unsigned>       m_hosts;        //Hosts of all 'c' records, in order.
+    size_t                      m_pos;
+    size_t                      m_hostpos;
+    bool                        m_sorted;
+
+};
+};
+
+
+#endif
@@ -0,0 +1,142 @@
+#include <inttypes.h>
+#include <deque>
+#include <vector>
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/nstime.h"
+#include "ns3/fatal-error.h"
+
+#include "trace-replayer.h"
+#include "event-profiler.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE ("TraceReplayer");
+
+TraceReplayer::TraceReplayer(GlobalContentManager *manager, TraceReader *reader)
+{
+    m_manager = manager;
+    m_reader = reader;
+    m_window = m_defaultwindow;
+    m_last = 0;
+    m_end = false;
+}
+
+void
+TraceReplayer::Preload()
+{
+    TraceRecord record;
+    const unsigned *hosts;
+    while (m_reader->Next(record, hosts))
+    {
+        if (record.m_op == 'c')
+        {
+            unsigned *h = new unsigned[record.m_host];
+            for (unsigned i=0; i<record.m_host; i++)
+            {
+                h[i] = hosts[i];
+            }
+            NS_LOG_LOGIC("Schedule create "<<record.m_content<<" on "<<record.m_host<<" hosts");
+            Simulator::Schedule(Seconds(record.m_time), &ns3::TraceReplayer::PreloadedCreate, this, record.m_content, record.m_host, h);
+        }
+        else if (record.m_op == 'u')
+        {
+            NS_LOG_LOGIC("Schedule update "<<record.m_content);
+            Simulator::Schedule(Seconds(record.m_time), &ns3::GlobalContentManager::UpdateContent, m_manager, record.m_content);
+        }
+        else if (record.m_op == 'a')
+        {
+            NS_LOG_LOGIC("Schedule access "<<record.m_content<<" on "<<record.m_host);
+            Simulator::Schedule(Seconds(record.m_time), &ns3::GlobalContentManager::RequireFile, m_manager, record.m_host, record.m_content);
+        }
+    }
+}
+
+void
+TraceReplayer::PreloadedCreate(uint64_t content, unsigned numHost, unsigned *hosts)
+{
+    TraceRecord record;
+    record.m_op = 'c';
+    record.m_content = content;
+    record.m_host = numHost;
+    Execute(record, hosts);
+    delete [] hosts;
+}
+
+void
+TraceReplayer::Stream(unsigned window)
+{
+    m_window = window > 0 ? window : 1;
+    Fill();
+}
+
+void
+TraceReplayer::Fill()
+{
+    ProfileScope profile(PROFILE_TRACE_FILL);
+    TraceRecord record;
+    const unsigned *hosts;
+    while (!m_end && m_records.size() < m_window)
+    {
+        if (!m_reader->Next(record, hosts))
+        {
+            m_end = true;
+            break;
+        }
+        if (record.m_time < m_last)
+        {
+            NS_FATAL_ERROR("Trace is not sorted by time (" << record.m_time << " after " << m_last << "), replay it with preloading");
+        }
+        m_last = record.m_time;
+
+        m_records.push_back(record);
+        if (record.m_op == 'c')
+        {
+            m_hosts.insert(m_hosts.end(), hosts, hosts + record.m_host);
+        }
+        //Records are sorted and equal times fire in scheduling order, so the events fire in the order of the window.
+        Simulator::Schedule(Seconds(record.m_time) - Simulator::Now(), &ns3::TraceReplayer::FireNext, this);
+    }
+    NS_LOG_LOGIC("Trace window holds "<<m_records.size()<<" records up to "<<m_last);
+}
+
+void
+TraceReplayer::FireNext()
+{
+    TraceRecord record = m_records.front();
+    m_records.pop_front();
+
+    unsigned numHost = (record.m_op == 'c') ? record.m_host : 0;
+    m_scratch.assign(m_hosts.begin(), m_hosts.begin() + numHost);
+    m_hosts.erase(m_hosts.begin(), m_hosts.begin() + numHost);
+    Execute(record, numHost > 0 ? &m_scratch[0] : 0);
+
+    //At or below half full; with a window of 1 that is whenever it runs empty.
+    if (m_records.size() <= m_window / 2)
+    {
+        Fill();
+    }
+}
+
+void
+TraceReplayer::Execute(const TraceRecord &record, unsigned *hosts)
+{
+    switch (record.m_op)
+    {
+    case 'c':
+        NS_LOG_LOGIC("Create chunk "<<record.m_content<<" on "<<record.m_host<<" hosts");
+        m_manager->CreateContent(record.m_content, record.m_host, hosts);
+        break;
+    case 'u':
+        NS_LOG_LOGIC("Update chunk "<<record.m_content);
+        m_manager->UpdateContent(record.m_content);
+        break;
+    case 'a':
+        NS_LOG_LOGIC("Access chunk "<<record.m_content<<" on "<<record.m_host);
+        m_manager->RequireFile(record.m_host, record.m_content);
+        break;
+    }
+}
+
+};
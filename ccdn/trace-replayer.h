@@ -0,0 +1,57 @@
+#ifndef TRACE_REPLAYER_H
+#define TRACE_REPLAYER_H
+
+#include <inttypes.h>
+#include <deque>
+#include <vector>
+
+#include "trace-reader.h"
+#include "global-content-manager.h"
+
+namespace ns3
+{
+
+/*
+ * Turn the records of a trace into simulator events on the content manager.
+ *
+ * Preload() schedules every record before the simulation starts, which works for a trace in
+ * any order but keeps the whole trace in the event queue. Stream() keeps only a window of
+ * upcoming records scheduled and reads more as the simulated time goes on, so memory stays
+ * flat however long the trace is; the records must then be sorted by time.
+ */
+class TraceReplayer
+{
+
+public:
+
+    TraceReplayer(GlobalContentManager *manager, TraceReader *reader);
+    ~TraceReplayer() {};
+
+    void Preload();
+    void Stream(unsigned window);
+
+    static const unsigned m_defaultwindow = 4096;
+
+private:
+
+    void Fill();
+    void FireNext();
+    void Execute(const TraceRecord &record, unsigned *hosts);
+    void PreloadedCreate(uint64_t content, unsigned numHost, unsigned *hosts);
+
+    GlobalContentManager    *m_manager;
+    TraceReader             *m_reader;
+
+    //The streaming window: scheduled records in time order, and the hosts of their 'c' records.
+    unsigned                m_window;
+    std::deque<TraceRecord> m_records;
+    std::deque<unsigned>    m_hosts;
+    std::vector<unsigned>   m_scratch;
+    double                  m_last;
+    bool                    m_end;
+
+};
+};
+
+
+#endif
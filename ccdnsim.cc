@@ -14,11 +14,20 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
-#include <fstream>
+#include <stdio.h>
+#include <time.h>
+#include <string>
 
 #include "ns3/parameter.h"
 #include "ns3/fat-tree-helper.h"
 #include "ns3/global-content-manager.h"
+#include "ns3/result-sink.h"
+#include "ns3/content-cache.h"
+#include "ns3/mix-routing.h"
+#include "ns3/trace-reader.h"
+#include "ns3/trace-replayer.h"
+#include "ns3/metrics-recorder.h"
+#include "ns3/event-profiler.h"
 
 
 #include "ns3/core-module.h"
@@ -26,122 +35,198 @@
 #include "ns3/internet-module.h"
 #include "ns3/point-to-point-module.h"
 #include "ns3/applications-module.h"
+#include "ns3/mpi-interface.h"
 
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("CCDN");
 
-void CreateContent(uint64_t content, unsigned numHost, unsigned *hosts);
-void UpdateContent(uint64_t content);
-void RequireFile(unsigned host, uint64_t content);
-void Review();
-void ParseSetup(Parameter *para, char* filename, double timescale);
+void ParseSetup(Parameter *para, char* filename, double timescale, std::string replay, unsigned window);
+
+static double
+WallSeconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void
+NoEvent()
+{
+}
+
+//Events scheduled so far: the uid of a new event, which is cancelled at once.
+static uint64_t
+ScheduledEvents()
+{
+    EventId probe = Simulator::Schedule(Seconds(0), &NoEvent);
+    Simulator::Cancel(probe);
+    return probe.GetUid();
+}
 
-double scanscap = 0.1;
 GlobalContentManager *manager = 0;
+TraceReader *reader = 0;
+TraceReplayer *replayer = 0;
 
 int
 main (int argc, char *argv[])
 {
+    double begin = WallSeconds();
 
     //The attributes:
     //1.port; 2.fib_size; 3.cache_size; 4.enable_cache, 5.timescale;
-    //6.input; 7.output;
+    //6.input (text, or binary from tools/ccdn-trace-convert); 7.output;
+    //Options may follow them:
+    //--resultFormat=text|binary
+    //--replay=auto|stream|preload  (stream needs a trace sorted by time, auto checks it first)
+    //--window=<records scheduled ahead when streaming>
+    //--transfer=packet|fluid  (fluid: flows share the links max-min fairly, no data packets)
+    //--cachePolicy=lru|lfu|arc|slru|tinylfu  (replacement policy of the host caches)
+    //--switchCache=<contents cached by each caching switch, 0 for none>  --switchCacheAt=edge|aggr|both
+    //--timeout=<seconds>  --backoff=<factor>  --maxTimeout=<seconds>  (retries of unanswered requests)
+    //--metrics=<seconds>  --metricsFormat=csv|json  (snapshots of the counters, to <output>.metrics.csv or .json; not with --distributed)
+    //--profile  (wall-clock time and calls of the CCDN handlers, printed at the end)
+    //--lean  (make fibs, caches and host sockets when first needed; for large fat-trees)
+    //--distributed  (run under mpirun; subtrees are split over the ranks, each rank writes output.<rank>)
 
     if (argc < 8)
     {
         return 0;
     }
 
+    std::string resultFormat = "text";
+    std::string replay = "auto";
+    std::string transfer = "packet";
+    std::string cachePolicy = "lru";
+    unsigned switchCache = 0;
+    std::string switchCacheAt = "edge";
+    unsigned window = TraceReplayer::m_defaultwindow;
+    bool distributed = false;
+    bool lean = false;
+    double timeout = 0.5;
+    double backoff = 2;
+    double maxTimeout = 8;
+    double metrics = 0;
+    std::string metricsFormat = "csv";
+    bool profile = false;
+    CommandLine cmd;
+    cmd.AddValue("resultFormat", "Format of the task results: text or binary", resultFormat);
+    cmd.AddValue("replay", "Trace replay mode: auto, stream or preload", replay);
+    cmd.AddValue("transfer", "Data transfer model: packet (TCP) or fluid", transfer);
+    cmd.AddValue("cachePolicy", "Cache replacement policy: lru, lfu, arc, slru or tinylfu", cachePolicy);
+    cmd.AddValue("switchCache", "Capacity of the on-path caches of the switches, 0 for none", switchCache);
+    cmd.AddValue("switchCacheAt", "Switches that cache: edge, aggr or both", switchCacheAt);
+    cmd.AddValue("window", "Number of trace records scheduled ahead when streaming", window);
+    cmd.AddValue("lean", "Make fibs, caches and host sockets when first needed", lean);
+    cmd.AddValue("timeout", "Seconds before an unanswered request is sent again", timeout);
+    cmd.AddValue("backoff", "Factor applied to the timeout on each retry", backoff);
+    cmd.AddValue("maxTimeout", "Longest timeout of a request, in seconds", maxTimeout);
+    cmd.AddValue("metrics", "Seconds of simulated time between metrics snapshots, 0 for none", metrics);
+    cmd.AddValue("metricsFormat", "Format of the metrics snapshots: csv or json", metricsFormat);
+    cmd.AddValue("profile", "Print the wall-clock time spent in each kind of event at the end", profile);
+    cmd.AddValue("distributed", "Split the fat-tree by subtree over the MPI ranks", distributed);
+    cmd.Parse(argc, argv);
+
+    int format = MetricsFormatFromName(metricsFormat.c_str());
+    if (format < 0)
+    {
+        NS_FATAL_ERROR("Unknown metrics format " << metricsFormat);
+    }
+
+    int policy = CachePolicyFromName(cachePolicy.c_str());
+    if (policy < 0)
+    {
+        NS_FATAL_ERROR("Unknown cache policy " << cachePolicy);
+    }
+
+    if (distributed)
+    {
+        GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::DistributedSimulatorImpl"));
+        MpiInterface::Enable (&argc, &argv);
+    }
+
     Parameter *para = new Parameter;
     para->port = std::atoi(argv[1]);
     para->fib_size = std::atoi(argv[2]);
     para->cache_size = std::atoi(argv[3]);
     para->enable_cache = argv[4][0] == '1';
+    para->cache_policy = policy;
+    para->switch_cache_size = switchCache;
+    para->switch_cache_layers = (switchCacheAt == "aggr") ? SWITCH_CACHE_AGGR
+                              : (switchCacheAt == "both") ? SWITCH_CACHE_EDGE | SWITCH_CACHE_AGGR : SWITCH_CACHE_EDGE;
     para->filename = argv[7];
+    para->result_format = (resultFormat == "binary") ? RESULT_BINARY : RESULT_TEXT;
+    para->lean_topology = lean;
+    para->fluid_transfer = (transfer == "fluid");
+    para->task_timeout = timeout;
+    para->task_backoff = backoff;
+    para->task_max_timeout = maxTimeout;
+    para->metrics_interval = metrics;
+    para->metrics_format = format;
+    para->systems = distributed ? MpiInterface::GetSize () : 1;
+    para->systemid = distributed ? MpiInterface::GetSystemId () : 0;
+
+    if (profile)
+    {
+        EventProfiler::Enable();
+    }
 
     manager = new GlobalContentManager();
-    ParseSetup(para, argv[6], std::atoi(argv[5]));
+    ParseSetup(para, argv[6], std::atoi(argv[5]), replay, window);
+    uint64_t events = ScheduledEvents();
+    double start = WallSeconds();
     Simulator::Run ();
+    double wall = WallSeconds() - start;
+    events = ScheduledEvents() - events;
+    double simulated = Simulator::Now().GetSeconds();
+
+    CacheStats stats = manager->GetCacheStats();
+    printf("cache %s: %llu lookups, %llu hits (%.4f), %llu insertions, %llu evictions\n",
+           CachePolicyName(para->cache_policy), (unsigned long long)stats.lookups, (unsigned long long)stats.hits,
+           stats.GetHitRatio(), (unsigned long long)stats.insertions, (unsigned long long)stats.evictions);
+    if (switchCache > 0)
+    {
+        stats = manager->GetSwitchCacheStats();
+        printf("switch cache %s: %llu lookups, %llu hits (%.4f), %llu insertions, %llu evictions\n",
+               switchCacheAt.c_str(), (unsigned long long)stats.lookups, (unsigned long long)stats.hits,
+               stats.GetHitRatio(), (unsigned long long)stats.insertions, (unsigned long long)stats.evictions);
+    }
+    printf("memory: %.0f bytes per node at construction, %llu bytes peak\n",
+           manager->GetHelper()->GetBytesPerNode(), (unsigned long long)FatTreeHelper::GetPeakResidentBytes());
+    printf("run: %.3f s startup, %.3f s wall, %.3f s simulated (%.3f per wall second), %llu events (%.0f per second)\n",
+           start - begin, wall, simulated, wall > 0 ? simulated / wall : 0,
+           (unsigned long long)events, wall > 0 ? events / wall : 0);
     Simulator::Destroy ();
+    if (distributed)
+    {
+        MpiInterface::Disable ();
+    }
     return 0;
 }
 
 
-void CreateContent(uint64_t content, unsigned numHost, unsigned *hosts)
-{
-    NS_LOG_LOGIC("Create chunk "<<content<<" on "<<numHost<<" hosts: first is "<<hosts[0]);
-    manager->CreateContent(content, numHost, hosts);
-}
-void UpdateContent(uint64_t content)
-{
-    NS_LOG_LOGIC("Update chunk "<<content);
-    manager->UpdateContent(content);
-}
-void RequireFile(unsigned host, uint64_t content)
-{
-    NS_LOG_LOGIC("Access chunk "<<content<<" on "<<host);
-    manager->RequireFile(host, content);
-}
-void Review()
-{
-    manager->ReviewFile();
-}
-
-
-void ParseSetup(Parameter *para, char* filename, double timescale)
+void ParseSetup(Parameter *para, char* filename, double timescale, std::string replay, unsigned window)
 {
+    manager->SetPara(para);
+    manager->Create();
 
-    std::ifstream is;
-    is.open(filename);
+    reader = TraceReader::Open(filename);
+    replayer = new TraceReplayer(manager, reader);
 
-    for (double cur_time = scanscap; cur_time <= timescale; cur_time += scanscap)
+    if (replay == "auto")
     {
-        //Simulator::Schedule(Seconds(cur_time), &Review);
+        replay = reader->IsSorted() ? "stream" : "preload";
+        NS_LOG_INFO("Trace replay mode: "<<replay);
     }
 
-    manager->SetPara(para);
-    manager->Create();
-
-    while (is.good())
+    if (replay == "stream")
     {
-        char command;
-        double time;
-        char content_in_char[16];
-        uint64_t content = 0;
-        is >> command >> time >> content_in_char;
-        for (int i=0; i<16; i++)
-        {
-            content = (content << 4) | (content_in_char[i] >= 97 ? content_in_char[i] - 87 : content_in_char[i] - 48);
-        }
-
-        if (command == 'c')
-        {
-            unsigned host;
-            is >> host;
-            unsigned *hosts = new unsigned[host];
-            for (unsigned i=0; i<host; i++)
-            {
-                is>>hosts[i];
-            }
-
-            NS_LOG_LOGIC("Schedule create "<<content<<" on "<<host<<" hosts: first is "<<hosts[0]);
-            Simulator::Schedule(Seconds(time), &CreateContent, content, host, hosts);
-        }
-        else if (command == 'u')
-        {
-            NS_LOG_LOGIC("Schedule update "<<content);
-            Simulator::Schedule(Seconds(time), &UpdateContent, content);
-        }
-        else if (command == 'a')
-        {
-            unsigned host;
-            is >> host;
-            NS_LOG_LOGIC("Schedule access "<<content<<" on "<<host);
-            Simulator::Schedule(Seconds(time), &RequireFile, host, content);
-        }
+        replayer->Stream(window);
+    }
+    else
+    {
+        replayer->Preload();
     }
-
-    is.close();
 }
@@ -0,0 +1,406 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ns3/parameter.h"
+#include "ns3/fat-tree-helper.h"
+#include "ns3/global-content-manager.h"
+#include "ns3/result-sink.h"
+#include "ns3/content-cache.h"
+#include "ns3/mix-routing.h"
+#include "ns3/trace-reader.h"
+#include "ns3/trace-replayer.h"
+#include "ns3/metrics-recorder.h"
+
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("CCDNSweep");
+
+/*
+ * Run ccdnsim over a grid of parameters. The trace is parsed once, into memory, before
+ * any simulation starts; every configuration then runs in a forked worker that shares
+ * the parsed trace copy-on-write. At most --jobs workers run at a time.
+ */
+
+struct SweepPoint
+{
+    Parameter para;
+    std::string filename;
+    pid_t pid;
+    int pipe;
+    bool done;
+    bool failed;
+    double wall;
+    //Written back by the worker.
+    ResultSummary summary;
+    CacheStats cache;
+    CacheStats switchcache;
+    unsigned pending;
+};
+
+//What a worker sends back to the sweep through its pipe.
+struct SweepReport
+{
+    ResultSummary summary;
+    CacheStats cache;
+    CacheStats switchcache;
+    unsigned pending;
+    double wall;
+};
+
+std::vector<std::string> SplitList(std::string list);
+std::vector<unsigned> ParseList(std::string list);
+double WallTime();
+void RunPoint(SweepPoint &point, TraceReader *reader, std::string replay);
+void WriteSummary(FILE *out, std::vector<SweepPoint> &points);
+
+int
+main (int argc, char *argv[])
+{
+
+    //The attributes:
+    //1.input (text, or binary from tools/ccdn-trace-convert); 2.output prefix;
+    //Options may follow them, each grid option is a comma separated list:
+    //--port=4,8  --fibSize=1000  --cacheSize=0,100  --enableCache=0,1  --cachePolicy=lru,arc
+    //--switchCache=0,100  --switchCacheAt=edge|aggr|both
+    //--jobs=<workers at a time, the number of cores by default>
+    //--resultFormat=text|binary  --replay=auto|stream|preload  --transfer=packet|fluid  --lean
+    //--timeout=<seconds>  --backoff=<factor>  --maxTimeout=<seconds>  --metrics=<seconds>  --metricsFormat=csv|json
+    //Every configuration writes <prefix>-p<port>-f<fib>-c<cache>-e<enable>-<policy>-s<switch cache>, and the summary
+    //table goes to <prefix>-summary.txt.
+
+    if (argc < 3)
+    {
+        return 0;
+    }
+
+    std::string port = "4";
+    std::string fibSize = "1000";
+    std::string cacheSize = "100";
+    std::string enableCache = "1";
+    std::string cachePolicy = "lru";
+    std::string switchCache = "0";
+    std::string switchCacheAt = "edge";
+    std::string resultFormat = "text";
+    std::string replay = "auto";
+    std::string transfer = "packet";
+    bool lean = false;
+    double timeout = 0.5;
+    double backoff = 2;
+    double maxTimeout = 8;
+    double metrics = 0;
+    std::string metricsFormat = "csv";
+    unsigned jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    CommandLine cmd;
+    cmd.AddValue("port", "Ports per switch", port);
+    cmd.AddValue("fibSize", "FIB size of the switches", fibSize);
+    cmd.AddValue("cacheSize", "Cache size of the hosts", cacheSize);
+    cmd.AddValue("enableCache", "0 or 1", enableCache);
+    cmd.AddValue("cachePolicy", "Cache replacement policies: lru, lfu, arc, slru, tinylfu", cachePolicy);
+    cmd.AddValue("switchCache", "Capacity of the on-path caches of the switches", switchCache);
+    cmd.AddValue("switchCacheAt", "Switches that cache: edge, aggr or both", switchCacheAt);
+    cmd.AddValue("jobs", "Number of simulations run at a time", jobs);
+    cmd.AddValue("resultFormat", "Format of the task results: text or binary", resultFormat);
+    cmd.AddValue("replay", "Trace replay mode: auto, stream or preload", replay);
+    cmd.AddValue("transfer", "Data transfer model: packet (TCP) or fluid", transfer);
+    cmd.AddValue("lean", "Make fibs, caches and host sockets when first needed", lean);
+    cmd.AddValue("timeout", "Seconds before an unanswered request is sent again", timeout);
+    cmd.AddValue("backoff", "Factor applied to the timeout on each retry", backoff);
+    cmd.AddValue("maxTimeout", "Longest timeout of a request, in seconds", maxTimeout);
+    cmd.AddValue("metrics", "Seconds of simulated time between metrics snapshots, 0 for none", metrics);
+    cmd.AddValue("metricsFormat", "Format of the metrics snapshots: csv or json", metricsFormat);
+    cmd.Parse(argc, argv);
+
+    int format = MetricsFormatFromName(metricsFormat.c_str());
+    if (format < 0)
+    {
+        NS_FATAL_ERROR("Unknown metrics format " << metricsFormat);
+    }
+
+    std::string prefix = argv[2];
+    jobs = jobs > 0 ? jobs : 1;
+
+    //Parse the trace once. A binary trace is mapped, and the mapping is shared as it is.
+    TraceReader *reader = TraceReader::Open(argv[1]);
+    if (!BinaryTraceReader::IsBinaryTrace(argv[1]))
+    {
+        TraceReader *memory = new MemoryTraceReader(reader);
+        delete reader;
+        reader = memory;
+    }
+
+    std::vector<unsigned> ports = ParseList(port);
+    std::vector<unsigned> fibs = ParseList(fibSize);
+    std::vector<unsigned> caches = ParseList(cacheSize);
+    std::vector<unsigned> enables = ParseList(enableCache);
+    std::vector<unsigned> switchCaches = ParseList(switchCache);
+    std::vector<std::string> policyNames = SplitList(cachePolicy);
+    std::vector<unsigned> policies;
+    for (unsigned i = 0; i < policyNames.size(); i++)
+    {
+        int policy = CachePolicyFromName(policyNames[i].c_str());
+        if (policy < 0)
+        {
+            NS_FATAL_ERROR("Unknown cache policy " << policyNames[i]);
+        }
+        policies.push_back(policy);
+    }
+
+    std::vector<SweepPoint> points;
+    for (unsigned a = 0; a < ports.size(); a++)
+    for (unsigned b = 0; b < fibs.size(); b++)
+    for (unsigned c = 0; c < caches.size(); c++)
+    for (unsigned d = 0; d < enables.size(); d++)
+    for (unsigned e = 0; e < policies.size(); e++)
+    for (unsigned f = 0; f < switchCaches.size(); f++)
+    {
+        SweepPoint point;
+        point.para.port = ports[a];
+        point.para.fib_size = fibs[b];
+        point.para.cache_size = caches[c];
+        point.para.enable_cache = enables[d] != 0;
+        point.para.cache_policy = policies[e];
+        point.para.switch_cache_size = switchCaches[f];
+        point.para.switch_cache_layers = (switchCacheAt == "aggr") ? SWITCH_CACHE_AGGR
+                                       : (switchCacheAt == "both") ? SWITCH_CACHE_EDGE | SWITCH_CACHE_AGGR : SWITCH_CACHE_EDGE;
+        point.para.result_format = (resultFormat == "binary") ? RESULT_BINARY : RESULT_TEXT;
+        point.para.lean_topology = lean;
+        point.para.fluid_transfer = (transfer == "fluid");
+        point.para.task_timeout = timeout;
+        point.para.task_backoff = backoff;
+        point.para.task_max_timeout = maxTimeout;
+        point.para.metrics_interval = metrics;
+        point.para.metrics_format = format;
+        point.para.systems = 1;
+        point.para.systemid = 0;
+        char name[128];
+        snprintf(name, sizeof(name), "-p%u-f%u-c%u-e%u-%s-s%u", ports[a], fibs[b], caches[c], enables[d], CachePolicyName(policies[e]), switchCaches[f]);
+        point.filename = prefix + name;
+        point.pid = -1;
+        point.pipe = -1;
+        point.done = false;
+        point.failed = false;
+        point.wall = 0;
+        point.pending = 0;
+        points.push_back(point);
+    }
+    NS_LOG_INFO("Sweeping " << points.size() << " configurations with " << jobs << " jobs");
+
+    //Keep jobs workers busy until every point is done.
+    std::map<pid_t, unsigned> running;
+    unsigned next = 0;
+    while (next < points.size() || !running.empty())
+    {
+        while (next < points.size() && running.size() < jobs)
+        {
+            SweepPoint &point = points[next];
+            int fds[2];
+            if (pipe(fds) != 0)
+            {
+                NS_FATAL_ERROR("Cannot create a pipe for the sweep worker");
+            }
+            fflush(stdout);
+            fflush(stderr);
+            pid_t pid = fork();
+            if (pid < 0)
+            {
+                NS_FATAL_ERROR("Cannot fork a sweep worker");
+            }
+            if (pid == 0)
+            {
+                close(fds[0]);
+                point.pipe = fds[1];
+                RunPoint(point, reader, replay);
+                _exit(0);
+            }
+            close(fds[1]);
+            point.pid = pid;
+            point.pipe = fds[0];
+            running[pid] = next;
+            next ++;
+        }
+
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0)
+        {
+            break;
+        }
+        std::map<pid_t, unsigned>::iterator iter = running.find(pid);
+        if (iter == running.end())
+        {
+            continue;
+        }
+        SweepPoint &point = points[iter->second];
+        running.erase(iter);
+
+        SweepReport report;
+        point.done = true;
+        point.failed = !WIFEXITED(status) || WEXITSTATUS(status) != 0
+            || read(point.pipe, &report, sizeof(report)) != (ssize_t)sizeof(report);
+        close(point.pipe);
+        if (!point.failed)
+        {
+            point.summary = report.summary;
+            point.cache = report.cache;
+            point.switchcache = report.switchcache;
+            point.pending = report.pending;
+            point.wall = report.wall;
+        }
+        NS_LOG_INFO(point.filename << (point.failed ? " failed" : " finished"));
+    }
+
+    std::string summary = prefix + "-summary.txt";
+    FILE *out = fopen(summary.c_str(), "w");
+    if (out == 0)
+    {
+        NS_FATAL_ERROR("Cannot open " << summary);
+    }
+    WriteSummary(out, points);
+    fclose(out);
+    WriteSummary(stdout, points);
+
+    delete reader;
+    return 0;
+}
+
+/*
+ * This runs in the worker. The summary is small enough to be written to the pipe
+ * atomically, and it stays there until the sweep reads it.
+ */
+void RunPoint(SweepPoint &point, TraceReader *reader, std::string replay)
+{
+    double start = WallTime();
+    point.para.filename = &point.filename[0];
+
+    GlobalContentManager *manager = new GlobalContentManager();
+    manager->SetPara(&point.para);
+    manager->Create();
+
+    reader->Rewind();
+    TraceReplayer *replayer = new TraceReplayer(manager, reader);
+    if (replay == "auto")
+    {
+        replay = reader->IsSorted() ? "stream" : "preload";
+    }
+    if (replay == "stream")
+    {
+        replayer->Stream(TraceReplayer::m_defaultwindow);
+    }
+    else
+    {
+        replayer->Preload();
+    }
+
+    Simulator::Run ();
+
+    SweepReport report;
+    report.summary = manager->GetTaskRecorder()->GetSummary();
+    report.pending = manager->GetTaskRecorder()->GetPendingTasks();
+    report.cache = manager->GetCacheStats();
+    report.switchcache = manager->GetSwitchCacheStats();
+    Simulator::Destroy ();
+    report.wall = WallTime() - start;
+
+    if (write(point.pipe, &report, sizeof(report)) != (ssize_t)sizeof(report))
+    {
+        _exit(1);
+    }
+    close(point.pipe);
+}
+
+void WriteSummary(FILE *out, std::vector<SweepPoint> &points)
+{
+    fprintf(out, "%6s %10s %10s %6s %8s %8s %10s %10s %10s %12s %10s %10s %10s %10s\n",
+            "port", "fib_size", "cache_size", "cache", "policy", "switch", "tasks", "pending", "cached", "latency", "hops",
+            "hit_ratio", "switch_hit", "wall");
+    for (std::vector<SweepPoint>::iterator iter = points.begin(); iter != points.end(); iter ++)
+    {
+        const Parameter &para = iter->para;
+        if (iter->failed || !iter->done)
+        {
+            fprintf(out, "%6u %10u %10u %6u %8s %8u %10s\n", para.port, para.fib_size, para.cache_size, para.enable_cache ? 1 : 0,
+                    CachePolicyName(para.cache_policy), para.switch_cache_size, "failed");
+            continue;
+        }
+        const ResultSummary &s = iter->summary;
+        double tasks = s.tasks > 0 ? (double)s.tasks : 1;
+        fprintf(out, "%6u %10u %10u %6u %8s %8u %10llu %10u %10.4f %12.6f %10.3f %10.4f %10.4f %10.2f\n",
+                para.port, para.fib_size, para.cache_size, para.enable_cache ? 1 : 0, CachePolicyName(para.cache_policy),
+                para.switch_cache_size, (unsigned long long)s.tasks, iter->pending, s.cached / tasks, s.latency / tasks,
+                s.hops / tasks, iter->cache.GetHitRatio(), iter->switchcache.GetHitRatio(), iter->wall);
+    }
+}
+
+std::vector<std::string> SplitList(std::string list)
+{
+    std::vector<std::string> values;
+    size_t begin = 0;
+    while (begin <= list.size())
+    {
+        size_t end = list.find(',', begin);
+        if (end == std::string::npos)
+        {
+            end = list.size();
+        }
+        if (end > begin)
+        {
+            values.push_back(list.substr(begin, end - begin));
+        }
+        begin = end + 1;
+    }
+    if (values.empty())
+    {
+        NS_FATAL_ERROR("Empty parameter list");
+    }
+    return values;
+}
+
+std::vector<unsigned> ParseList(std::string list)
+{
+    std::vector<std::string> items = SplitList(list);
+    std::vector<unsigned> values;
+    for (unsigned i = 0; i < items.size(); i++)
+    {
+        values.push_back(std::atoi(items[i].c_str()));
+    }
+    return values;
+}
+
+double WallTime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
@@ -0,0 +1,79 @@
+/*
+ * Convert a binary result file written by ccdnsim --resultFormat=binary into CSV.
+ *
+ * Build:  g++ -O2 -I../ccdn ccdn-result2csv.cc -o ccdn-result2csv
+ * Usage:  ccdn-result2csv <result.bin> [output.csv]
+ *
+ * The output goes to stdout if no output file is given.
+ */
+
+#define __STDC_FORMAT_MACROS 1
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "result-record.h"
+
+using namespace ns3;
+
+int
+main (int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <result.bin> [output.csv]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = fopen(argv[1], "rb");
+    if (in == 0)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+    FILE *out = argc > 2 ? fopen(argv[2], "w") : stdout;
+    if (out == 0)
+    {
+        perror(argv[2]);
+        return 1;
+    }
+
+    uint8_t header[RESULT_HEADER_SIZE];
+    unsigned recordsize = 0;
+    if (fread(header, 1, RESULT_HEADER_SIZE, in) == RESULT_HEADER_SIZE)
+    {
+        recordsize = DecodeResultHeader(header);
+    }
+    if (recordsize < RESULT_RECORD_SIZE)
+    {
+        fprintf(stderr, "%s is not a ccdn result file\n", argv[1]);
+        return 1;
+    }
+
+    static uint8_t buf[4096 * RESULT_RECORD_SIZE];
+    uint64_t count = 0;
+    fprintf(out, "content,remote,local,start,finish,hops,cached\n");
+    for (;;)
+    {
+        size_t n = fread(buf, recordsize, sizeof(buf) / recordsize, in);
+        for (size_t i = 0; i < n; i++)
+        {
+            TaskResult r;
+            DecodeResult(buf + i * recordsize, r);
+            fprintf(out, "%" PRIu64 ",%u,%u,%.9f,%.9f,%u,%u\n",
+                    r.content, r.remote, r.local, r.start, r.finish, r.hops, r.cached);
+        }
+        count += n;
+        if (n < sizeof(buf) / recordsize)
+        {
+            break;
+        }
+    }
+
+    fclose(in);
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+    fprintf(stderr, "%" PRIu64 " records\n", count);
+    return 0;
+}
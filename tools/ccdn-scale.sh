@@ -0,0 +1,53 @@
+#!/bin/sh
+#
+# Run ccdnsim on synthetic traces of growing fat-trees and print one CSV line per size.
+#
+# Usage:  ccdn-scale.sh [k ...]      (default: 4 8 16 24)
+#
+# Environment:
+#   CCDNSIM     the simulator            (./build/scratch/ccdnsim)
+#   TRACEGEN    the trace generator      (./tools/ccdn-trace-gen, built from tools/ccdn-trace-gen.cc if missing)
+#   GENARGS     options of the generator (--replicas=2 --rate=1000)
+#   SIMARGS     options of ccdnsim       (--lean)
+#   FIB, CACHE  fib and cache sizes      (1000, 100)
+#   WORKDIR     traces and results       (a new directory under /tmp)
+#
+# Columns: k,hosts,records,startup_s,wall_s,sim_s,sim_per_wall,events,events_per_s,peak_rss
+
+CCDNSIM=${CCDNSIM:-./build/scratch/ccdnsim}
+TRACEGEN=${TRACEGEN:-./tools/ccdn-trace-gen}
+GENARGS=${GENARGS:---replicas=2 --rate=1000}
+SIMARGS=${SIMARGS:---lean}
+FIB=${FIB:-1000}
+CACHE=${CACHE:-100}
+WORKDIR=${WORKDIR:-$(mktemp -d /tmp/ccdn-scale.XXXXXX)}
+
+if [ ! -x "$TRACEGEN" ]; then
+    g++ -O2 -o "$TRACEGEN" "$(dirname "$0")/ccdn-trace-gen.cc" || exit 1
+fi
+if [ ! -x "$CCDNSIM" ]; then
+    echo "No ccdnsim at $CCDNSIM, set CCDNSIM" >&2
+    exit 1
+fi
+if [ $# -eq 0 ]; then
+    set -- 4 8 16 24
+fi
+
+echo "k,hosts,records,startup_s,wall_s,sim_s,sim_per_wall,events,events_per_s,peak_rss"
+for k in "$@"; do
+    trace="$WORKDIR/trace.$k.txt"
+    log="$WORKDIR/log.$k.txt"
+    "$TRACEGEN" "$k" "$trace" $GENARGS 2> /dev/null || exit 1
+    "$CCDNSIM" "$k" "$FIB" "$CACHE" 1 1 "$trace" "$WORKDIR/result.$k" $SIMARGS > "$log" 2>&1 || {
+        echo "ccdnsim failed for k = $k, see $log" >&2
+        continue
+    }
+    records=$(wc -l < "$trace")
+    #run: <startup> s startup, <wall> s wall, <sim> s simulated (<ratio> per wall second), <events> events (<rate> per second)
+    #memory: <bytes> bytes per node at construction, <peak> bytes peak
+    awk -v k="$k" -v records="$records" '
+        /^run:/    {startup = $2; wall = $5; sim = $8; ratio = substr($11, 2); events = $15; rate = substr($17, 2)}
+        /^memory:/ {peak = $8}
+        END        {printf "%s,%d,%d,%s,%s,%s,%s,%s,%s,%s\n", k, k * k * k / 4, records,
+                           startup, wall, sim, ratio, events, rate, peak}' "$log"
+done
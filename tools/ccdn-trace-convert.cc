@@ -0,0 +1,37 @@
+/*
+ * Convert a text trace into the binary trace format that ccdnsim memory-maps.
+ *
+ * Build:  g++ -O2 -I../ccdn ccdn-trace-convert.cc ../ccdn/trace-format.cc -o ccdn-trace-convert
+ * Usage:  ccdn-trace-convert <trace.txt> <trace.bin>
+ */
+
+#include <stdio.h>
+#include <sys/time.h>
+
+#include "trace-format.h"
+
+using namespace ns3;
+
+int
+main (int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s <trace.txt> <trace.bin>\n", argv[0]);
+        return 1;
+    }
+
+    struct timeval begin, end;
+    gettimeofday(&begin, 0);
+    int64_t records = ConvertTextTrace(argv[1], argv[2]);
+    gettimeofday(&end, 0);
+    if (records < 0)
+    {
+        fprintf(stderr, "Failed to convert %s into %s\n", argv[1], argv[2]);
+        return 1;
+    }
+
+    double seconds = (end.tv_sec - begin.tv_sec) + (end.tv_usec - begin.tv_usec) / 1e6;
+    fprintf(stderr, "%lld records converted in %.3f s\n", (long long)records, seconds);
+    return 0;
+}
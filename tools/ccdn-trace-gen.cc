@@ -0,0 +1,213 @@
+/*
+ * Generate a synthetic text trace for a k-ary fat-tree, in the format ccdnsim reads.
+ *
+ * Build:  g++ -O2 ccdn-trace-gen.cc -o ccdn-trace-gen
+ * Usage:  ccdn-trace-gen <k> <trace.txt> [options]
+ *
+ * Options:
+ *   --contents=<n>      contents created at time 0 (default 5 per host)
+ *   --replicas=<n>      replicas of each content (1)
+ *   --maxReplicas=<n>   if more than --replicas, each content gets a uniform count in between
+ *   --requests=<n>      accesses to generate (5 per host)
+ *   --rate=<n>          accesses per second over all hosts, Poisson arrivals (100)
+ *   --updateRate=<n>    updates per second, Poisson arrivals (0)
+ *   --alpha=<x>         Zipf exponent of the content popularity (0.8)
+ *   --locality=<p>      chance that an access repeats one of the last --window contents (0)
+ *   --window=<n>        recent accesses the repeats are drawn from (1000)
+ *   --seed=<n>          (1)
+ *
+ * Accesses and updates both pick contents by popularity, and a host uniformly. Records are
+ * written in time order, so ccdnsim can stream the trace.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+//xorshift64*
+struct GenRandom
+{
+    uint64_t m_state;
+    GenRandom(uint64_t seed) : m_state(seed * 0x9e3779b97f4a7c15ULL + 1) {};
+    uint64_t Next()
+    {
+        m_state ^= m_state >> 12;
+        m_state ^= m_state << 25;
+        m_state ^= m_state >> 27;
+        return m_state * 0x2545f4914f6cdd1dULL;
+    };
+    double NextDouble() {return (Next() >> 11) * (1.0 / 9007199254740992.0);};
+    unsigned Below(unsigned n) {return (unsigned)(NextDouble() * n);};
+    double Exponential(double rate) {return -std::log(1.0 - NextDouble()) / rate;};
+};
+
+//Popularity ranks 0..n-1, drawn with probability proportional to 1 / (rank + 1)^alpha.
+class ZipfDraw
+{
+public:
+    ZipfDraw(unsigned n, double alpha) : m_cdf(n)
+    {
+        double sum = 0;
+        for (unsigned i = 0; i < n; i++)
+        {
+            sum += 1.0 / std::pow(i + 1.0, alpha);
+            m_cdf[i] = sum;
+        }
+        for (unsigned i = 0; i < n; i++)
+        {
+            m_cdf[i] /= sum;
+        }
+    };
+    unsigned Draw(GenRandom &random) const
+    {
+        return std::lower_bound(m_cdf.begin(), m_cdf.end() - 1, random.NextDouble()) - m_cdf.begin();
+    };
+private:
+    std::vector<double> m_cdf;
+};
+
+//Return true and set value if arg is --name=<value>.
+static bool
+Option(const char *arg, const char *name, double &value)
+{
+    size_t len = strlen(name);
+    if (strncmp(arg, "--", 2) != 0 || strncmp(arg + 2, name, len) != 0 || arg[2 + len] != '=')
+    {
+        return false;
+    }
+    value = atof(arg + 3 + len);
+    return true;
+}
+
+int
+main (int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s <k> <trace.txt> [--contents=n] [--replicas=n] [--maxReplicas=n] [--requests=n]\n"
+                        "       [--rate=n] [--updateRate=n] [--alpha=x] [--locality=p] [--window=n] [--seed=n]\n", argv[0]);
+        return 1;
+    }
+
+    unsigned k = atoi(argv[1]);
+    if (k < 2 || k % 2 != 0 || k > 128)
+    {
+        fprintf(stderr, "k must be even, from 2 to 128\n");
+        return 1;
+    }
+    unsigned hosts = k * k * k / 4;
+
+    double contents = hosts * 5;
+    double replicas = 1;
+    double maxReplicas = 0;
+    double requests = hosts * 5;
+    double rate = 100;
+    double updateRate = 0;
+    double alpha = 0.8;
+    double locality = 0;
+    double window = 1000;
+    double seed = 1;
+    for (int i = 3; i < argc; i++)
+    {
+        if (!Option(argv[i], "contents", contents) && !Option(argv[i], "replicas", replicas) &&
+            !Option(argv[i], "maxReplicas", maxReplicas) && !Option(argv[i], "requests", requests) &&
+            !Option(argv[i], "rate", rate) && !Option(argv[i], "updateRate", updateRate) &&
+            !Option(argv[i], "alpha", alpha) && !Option(argv[i], "locality", locality) &&
+            !Option(argv[i], "window", window) && !Option(argv[i], "seed", seed))
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    unsigned minrep = std::max(1U, std::min((unsigned)replicas, hosts));
+    unsigned maxrep = std::max(minrep, std::min((unsigned)maxReplicas, hosts));
+    if (contents < 1 || rate <= 0)
+    {
+        fprintf(stderr, "Need at least one content and a positive rate\n");
+        return 1;
+    }
+
+    FILE *out = fopen(argv[2], "w");
+    if (out == 0)
+    {
+        fprintf(stderr, "Cannot open %s\n", argv[2]);
+        return 1;
+    }
+
+    GenRandom random((uint64_t)seed);
+    ZipfDraw zipf((unsigned)contents, alpha);
+
+    //Content names, in the order of their popularity.
+    std::vector<uint64_t> names((unsigned)contents);
+    std::vector<unsigned> chosen;
+    for (unsigned i = 0; i < names.size(); i++)
+    {
+        names[i] = random.Next();
+        unsigned count = minrep + random.Below(maxrep - minrep + 1);
+        chosen.clear();
+        while (chosen.size() < count)
+        {
+            unsigned host = random.Below(hosts);
+            if (std::find(chosen.begin(), chosen.end(), host) == chosen.end())
+            {
+                chosen.push_back(host);
+            }
+        }
+        fprintf(out, "c 0.0 %016llx %u", (unsigned long long)names[i], count);
+        for (unsigned j = 0; j < count; j++)
+        {
+            fprintf(out, " %u", chosen[j]);
+        }
+        fputc('\n', out);
+    }
+
+    //Accesses and updates are two Poisson processes, merged in time order.
+    std::vector<unsigned> recent;
+    unsigned recentnext = 0;
+    double access = random.Exponential(rate);
+    double update = updateRate > 0 ? random.Exponential(updateRate) : HUGE_VAL;
+    uint64_t written = 0;
+    double last = 0;
+    while (written < (uint64_t)requests)
+    {
+        if (update < access)
+        {
+            fprintf(out, "u %.9f %016llx\n", update, (unsigned long long)names[zipf.Draw(random)]);
+            update += random.Exponential(updateRate);
+            continue;
+        }
+
+        unsigned rank;
+        if (!recent.empty() && random.NextDouble() < locality)
+        {
+            rank = recent[random.Below(recent.size())];
+        }
+        else
+        {
+            rank = zipf.Draw(random);
+        }
+        if (recent.size() < (unsigned)window)
+        {
+            recent.push_back(rank);
+        }
+        else if (!recent.empty())
+        {
+            recent[recentnext] = rank;
+            recentnext = (recentnext + 1) % recent.size();
+        }
+
+        fprintf(out, "a %.9f %016llx %u\n", access, (unsigned long long)names[rank], random.Below(hosts));
+        last = access;
+        access += random.Exponential(rate);
+        written ++;
+    }
+
+    fclose(out);
+    fprintf(stderr, "k = %u: %u hosts, %u contents, %llu accesses until %.3f s\n",
+            k, hosts, (unsigned)names.size(), (unsigned long long)written, last);
+    return 0;
+}